@@ -1,32 +1,87 @@
 #pragma once
 
 #include "basic.h"
+#include <memory.h>
+
+// Same as malloc, every allocator aligns memory at least to this
+#define ALLOCATOR_DEFAULT_ALIGNMENT 16
+#define CACHE_LINE_SIZE             64
 
 struct Allocator;
 
 typedef void* (*AllocateFn)(Allocator* allocator, u64 size);
+typedef void* (*AllocateAlignedFn)(Allocator* allocator, u64 size, u64 alignment); // alignment must be a power of 2
 typedef void* (*ReallocateFn)(Allocator* allocator, void* ptr, u64 new_size);
 typedef void  (*FreeFn)(Allocator* allocator, void* ptr);
 
 struct Allocator {
-    AllocateFn   alloc;
-    ReallocateFn realloc;
-    FreeFn       free;
-    void        *context;
+    AllocateFn        alloc;
+    AllocateAlignedFn alloc_aligned;
+    ReallocateFn      realloc;
+    FreeFn            free;
+    void             *context;
 };
 
+/*
+    Call site tag of the allocations made on this thread, allocators that track memory use it
+    to group allocations. Containers tag their allocations with ALLOCATOR_TAG when ALLOCATOR_TRACKING is defined.
+*/
+inline thread_local const char* Allocator_Tag = null;
+
+struct Allocator_Tag_Scope {
+    const char* previous;
+
+    Allocator_Tag_Scope(const char* tag) : previous(Allocator_Tag) {
+        Allocator_Tag = tag;
+    }
+
+    ~Allocator_Tag_Scope() {
+        Allocator_Tag = previous;
+    }
+};
+
+#ifdef ALLOCATOR_TRACKING
+    #define ALLOCATOR_TAG(tag) Allocator_Tag_Scope allocator_tag_scope(tag)
+#else
+    #define ALLOCATOR_TAG(tag)
+#endif
+
 static inline
 void*
 allocator_alloc(Allocator *allocator, u64 size) {
     return allocator->alloc(allocator, size);
 }
 
+static inline
+void*
+allocator_alloc_aligned(Allocator *allocator, u64 size, u64 alignment) {
+    return allocator->alloc_aligned(allocator, size, alignment);
+}
+
 static inline
 void*
 allocator_realloc(Allocator *allocator, void* ptr, u64 size) {
     return allocator->realloc(allocator, ptr, size);
 }
 
+// realloc keeps only the default alignment, so bigger alignments are moved by hand.
+static inline
+void*
+allocator_realloc_aligned(Allocator *allocator, void* ptr, u64 old_size, u64 new_size, u64 alignment) {
+    if (alignment <= ALLOCATOR_DEFAULT_ALIGNMENT) {
+        return allocator->realloc(allocator, ptr, new_size);
+    }
+
+    void* new_ptr = allocator->alloc_aligned(allocator, new_size, alignment);
+
+    if (new_ptr && ptr) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        allocator->free(allocator, ptr);
+    }
+
+    return new_ptr;
+}
+
 static inline
 void
 allocator_free(Allocator *allocator, void* ptr) {
@@ -9,78 +9,483 @@
 #ifdef USE_MALLOC
     #include "malloc.h"
     #define Arena_Malloc(size)       malloc(size)
-    #define Arena_Realloc(ptr, size) realloc(ptr, size)
     #define Arena_Free(ptr)          free(ptr)
 #else
     #define Arena_Malloc(size)
     #define Arena_Free(ptr)
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #define ARENA_VIRTUAL_MEMORY
+#endif
+
 // 8MB size by default
 #define ARENA_INITIAL_CAPACITY 1024 * 1024 * 8
-// resize by 1MB
-#define ARENA_RESIZE_STEP 1024 * 1024
+// every new block is twice as big as the previous one
+#define ARENA_GROWTH_FACTOR 2
+// virtual arenas reserve 64GB of address space by default
+#define ARENA_VIRTUAL_RESERVE 64ull * 1024 * 1024 * 1024
+// and commit it in 64KB steps
+#define ARENA_COMMIT_STEP 64 * 1024
+// committed memory above 64MB is given back to the os on reset
+#define ARENA_DECOMMIT_HIGH_WATER 64 * 1024 * 1024
+
+// Arena flags
+#define ARENA_VIRTUAL 0x1 // the first block is a reserved virtual range, see arena_make_virtual
+
+/*
+    Arena is a chain of blocks. When the current block runs out, a new block is linked after it,
+    the old one is never moved, so every pointer handed out stays valid until the arena is reset.
+    Blocks are kept on reset and reused by the following allocations.
+
+    Virtual arena reserves a huge range of address space with a single block and commits pages
+    only when allocated moves past them, so the memory is contiguous and costs nothing until it's used.
+*/
+struct Arena_Block {
+    Arena_Block* next;
+    u8*          data;
+    u64          capacity;
+    u64          committed; // equals capacity for malloc'ed blocks
+    u64          allocated;
+};
 
 struct Arena {
-    u8* data;
-    u64 capacity;
-    u64 allocated;
+    Arena_Block* first;
+    Arena_Block* current;
+    u8*          last;          // the most recent allocation, it can grow and shrink in place
+    u64          next_capacity; // capacity of the next block to be chained
+    u32          flags;
 };
 
+// Position in the arena, everything allocated after it can be dropped with arena_rewind.
+struct Arena_Mark {
+    Arena_Block* block;
+    u64          allocated;
+};
+
+static inline
+Arena*
+arena_make(u64 initial_capacity = ARENA_INITIAL_CAPACITY);
+
+#ifdef ARENA_VIRTUAL_MEMORY
+static inline
+Arena*
+arena_make_virtual(u64 reserve = ARENA_VIRTUAL_RESERVE);
+#endif
+
+static inline
+Allocator
+arena_allocator_make(Arena* arena);
+
+static inline
+void
+arena_destroy(Arena* arena);
+
+static inline
+void
+arena_reset(Arena* arena);
+
+static inline
+Arena_Mark
+arena_get_mark(Arena* arena);
+
+static inline
+void
+arena_rewind(Arena* arena, Arena_Mark mark); // Frees everything allocated after the mark. Blocks are kept for reuse.
+
+static inline
+void*
+arena_push(Arena* arena, u64 size, u64 alignment = ALLOCATOR_DEFAULT_ALIGNMENT);
+
+static inline
+void*
+arena_repush(Arena* arena, void* ptr, u64 size, u64 alignment = ALLOCATOR_DEFAULT_ALIGNMENT); // Resizes allocation in place if it's the last one, otherwise moves it.
+
+static inline
+void
+arena_pop(Arena* arena, void* ptr); // Frees ptr if it's the last allocation, otherwise does nothing.
+
+static inline
+void*
+arena_alloc(Allocator* allocator, u64 size);
+
+static inline
+void*
+arena_alloc_aligned(Allocator* allocator, u64 size, u64 alignment);
+
+static inline
+void*
+arena_realloc(Allocator* allocator, void* ptr, u64 size);
+
 static inline
 void
-arena_resize(Arena* arena, u64 size);
+arena_free(Allocator* allocator, void* ptr); // Resets the whole arena if ptr is null, pops ptr if it's the last allocation, otherwise does nothing.
+
+static inline
+Arena_Block*
+arena_block_make(u64 capacity);
+
+static inline
+Arena_Block*
+arena_grow(Arena* arena, u64 size);
+
+static inline
+u64
+arena_align(Arena_Block* block, u64 alignment);
+
+static inline
+u64
+arena_used_after(Arena* arena, u8* ptr);
 
+#ifdef ARENA_VIRTUAL_MEMORY
+static inline
+bool
+arena_commit(Arena_Block* block, u64 size); // Returns false if the os cannot give the memory.
+
+static inline
+void
+arena_decommit(Arena_Block* block, u64 size);
+#endif
+
+/*
+    Rewinds the arena back when the scope ends, so scratch memory of the inner phase is dropped in O(1):
+    {
+        Arena_Scope scope(get_temp_arena());
+        auto list = list_make<u32>(LIST_DEFAULT_LENGTH, &Allocator_Temp);
+        ...
+    }
+*/
+struct Arena_Scope {
+    Arena*     arena;
+    Arena_Mark mark;
+
+    Arena_Scope(Arena* arena) : arena(arena),
+                                mark(arena_get_mark(arena)) {
+    }
+
+    ~Arena_Scope() {
+        arena_rewind(arena, mark);
+    }
+};
+
+// Implementation
 static inline
 Arena*
-arena_make(u64 initial_capacity = ARENA_INITIAL_CAPACITY) {
+arena_make(u64 initial_capacity) {
     Arena* arena = (Arena*)Arena_Malloc(sizeof(Arena));
     Assert(arena, "Cannot allocate arena.");
-    u8* data = (u8*)Arena_Malloc(initial_capacity);
-    Assert(data, "Cannot allocate arena's data.");
 
-    arena->data      = data;
-    arena->capacity  = initial_capacity;
-    arena->allocated = 0;
+    arena->first         = arena_block_make(initial_capacity);
+    arena->current       = arena->first;
+    arena->last          = null;
+    arena->next_capacity = initial_capacity * ARENA_GROWTH_FACTOR;
+    arena->flags         = 0;
 
     return arena;
 }
 
+#ifdef ARENA_VIRTUAL_MEMORY
+static inline
+Arena*
+arena_make_virtual(u64 reserve) {
+    Arena* arena = (Arena*)Arena_Malloc(sizeof(Arena));
+    Assert(arena, "Cannot allocate arena.");
+    Arena_Block* block = (Arena_Block*)Arena_Malloc(sizeof(Arena_Block));
+    Assert(block, "Cannot allocate arena block.");
+    void* data = mmap(null, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    Assert(data != MAP_FAILED, "Cannot reserve virtual memory for arena.");
+
+    block->next      = null;
+    block->data      = (u8*)data;
+    block->capacity  = reserve;
+    block->committed = 0;
+    block->allocated = 0;
+
+    arena->first         = block;
+    arena->current       = block;
+    arena->last          = null;
+    arena->next_capacity = ARENA_INITIAL_CAPACITY;
+    arena->flags         = ARENA_VIRTUAL;
+
+    return arena;
+}
+#endif
+
+static inline
+Allocator
+arena_allocator_make(Arena* arena) {
+    Allocator allocator = {
+        .alloc         = arena_alloc,
+        .alloc_aligned = arena_alloc_aligned,
+        .realloc       = arena_realloc,
+        .free          = arena_free,
+        .context       = arena
+    };
+
+    return allocator;
+}
+
+static inline
+void
+arena_destroy(Arena* arena) {
+    Arena_Block* block = arena->first;
+
+#ifdef ARENA_VIRTUAL_MEMORY
+    if (arena->flags & ARENA_VIRTUAL) {
+        munmap(block->data, block->capacity);
+        Arena_Block* next = block->next;
+        Arena_Free(block);
+        block = next;
+    }
+#endif
+
+    while (block) {
+        Arena_Block* next = block->next;
+        Arena_Free(block);
+        block = next;
+    }
+
+    Arena_Free(arena);
+}
+
+static inline
+void
+arena_reset(Arena* arena) {
+    arena->current            = arena->first;
+    arena->current->allocated = 0;
+    arena->last               = null;
+
+#ifdef ARENA_VIRTUAL_MEMORY
+    if (arena->flags & ARENA_VIRTUAL && arena->first->committed > ARENA_DECOMMIT_HIGH_WATER) {
+        arena_decommit(arena->first, ARENA_DECOMMIT_HIGH_WATER);
+    }
+#endif
+}
+
+static inline
+Arena_Mark
+arena_get_mark(Arena* arena) {
+    Arena_Mark mark;
+    mark.block     = arena->current;
+    mark.allocated = arena->current->allocated;
+
+    return mark;
+}
+
+static inline
+void
+arena_rewind(Arena* arena, Arena_Mark mark) {
+    Assert(mark.block, "Cannot rewind arena to an empty mark.");
+    arena->current            = mark.block;
+    arena->current->allocated = mark.allocated;
+    arena->last               = null;
+}
+
 static inline
 void*
-arena_alloc(Allocator* allocator, u64 size) {
-    Arena* arena = (Arena*)allocator->context;
+arena_push(Arena* arena, u64 size, u64 alignment) {
     Assert(arena, "Cannot allocate data, because arena is null.");
+    Assert((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2.");
+    Arena_Block* block  = arena->current;
+    u64          offset = arena_align(block, alignment);
+
+    if (block->committed < offset + size) {
+        block = arena_grow(arena, size + alignment - 1);
+        if (!block) return null;
 
-    if (arena->capacity < arena->allocated + size) {
-        arena_resize(arena, arena->allocated + size + ARENA_RESIZE_STEP);
+        offset = arena_align(block, alignment);
     }
 
-    void* ptr = &arena->data[arena->allocated];
+    u8* ptr = &block->data[offset];
 
-    arena->allocated += size;
+    block->allocated = offset + size;
+    arena->last      = ptr;
 
     return ptr;
 }
 
+static inline
+void*
+arena_repush(Arena* arena, void* ptr, u64 size, u64 alignment) {
+    if (!ptr) return arena_push(arena, size, alignment);
+
+    Arena_Block* block = arena->current;
+    u8*          old   = (u8*)ptr;
+
+    if (old == arena->last) {
+        u64 end = (u64)(old - block->data) + size;
+
+        if (end <= block->committed) {
+            block->allocated = end;
+            return ptr;
+        }
+
+#ifdef ARENA_VIRTUAL_MEMORY
+        if (end <= block->capacity && arena_commit(block, end)) {
+            block->allocated = end;
+            return ptr;
+        }
+#endif
+    }
+
+    // Arena doesn't know sizes of the allocations, so everything up to the end of the used part
+    // of the block is copied, bytes after the old allocation are garbage for the caller anyway.
+    u64   old_size = arena_used_after(arena, old);
+    void* new_ptr  = arena_push(arena, size, alignment);
+
+    if (!new_ptr) return null;
+
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+
+    return new_ptr;
+}
+
+static inline
+void
+arena_pop(Arena* arena, void* ptr) {
+    if (ptr != arena->last) return;
+
+    arena->current->allocated = arena->last - arena->current->data;
+    arena->last               = null;
+}
+
+static inline
+void*
+arena_alloc(Allocator* allocator, u64 size) {
+    return arena_push((Arena*)allocator->context, size);
+}
+
+static inline
+void*
+arena_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    return arena_push((Arena*)allocator->context, size, alignment);
+}
+
 static inline
 void*
 arena_realloc(Allocator* allocator, void* ptr, u64 size) {
-    Assert(false, "Cannot realloc data, using arena allocator");
-    return null;
+    return arena_repush((Arena*)allocator->context, ptr, size);
 }
 
 static inline
 void
 arena_free(Allocator* allocator, void* ptr) {
     Arena* arena = (Arena*)allocator->context;
-    arena->allocated = 0;
+
+    if (ptr) {
+        arena_pop(arena, ptr);
+    } else {
+        arena_reset(arena);
+    }
+}
+
+static inline
+Arena_Block*
+arena_block_make(u64 capacity) {
+    // data lives right after the block header, one malloc per block
+    Arena_Block* block = (Arena_Block*)Arena_Malloc(sizeof(Arena_Block) + capacity);
+    Assert(block, "Cannot allocate arena block.");
+
+    block->next      = null;
+    block->data      = (u8*)(block + 1);
+    block->capacity  = capacity;
+    block->committed = capacity;
+    block->allocated = 0;
+
+    return block;
+}
+
+// Slow path of arena_push: commits more pages of the virtual block or moves to the next block.
+// Returns null if the pages cannot be committed.
+static inline
+Arena_Block*
+arena_grow(Arena* arena, u64 size) {
+    Arena_Block* block = arena->current;
+
+#ifdef ARENA_VIRTUAL_MEMORY
+    if (block->capacity >= block->allocated + size) {
+        return arena_commit(block, block->allocated + size) ? block : null;
+    }
+#endif
+
+    // Blocks after the current one are left from previous resets, reuse them if they fit.
+    Arena_Block* next = block->next;
+
+    if (next && next->capacity >= size) {
+        block = next;
+    } else {
+        u64 capacity = arena->next_capacity;
+
+        while (capacity < size) capacity *= ARENA_GROWTH_FACTOR;
+
+        block                = arena_block_make(capacity);
+        block->next          = next;
+        arena->current->next = block;
+        arena->next_capacity = capacity * ARENA_GROWTH_FACTOR;
+    }
+
+    block->allocated = 0;
+    arena->current   = block;
+
+    return block;
+}
+
+// Returns offset of the first free byte of the block that is aligned to alignment.
+static inline
+u64
+arena_align(Arena_Block* block, u64 alignment) {
+    u64 address = (u64)(block->data + block->allocated);
+    u64 aligned = (address + alignment - 1) & ~(alignment - 1);
+
+    return block->allocated + (aligned - address);
+}
+
+// Returns how many bytes are used in the block that contains ptr, starting from ptr.
+static inline
+u64
+arena_used_after(Arena* arena, u8* ptr) {
+    for (Arena_Block* block = arena->first; block; block = block->next) {
+        if (ptr >= block->data && ptr < block->data + block->allocated) {
+            return block->data + block->allocated - ptr;
+        }
+
+        if (block == arena->current) break;
+    }
+
+    Assert(false, "Pointer was not allocated by this arena.");
+    return 0;
 }
 
+#ifdef ARENA_VIRTUAL_MEMORY
+// Makes first size bytes of the block readable and writable.
+static inline
+bool
+arena_commit(Arena_Block* block, u64 size) {
+    u64 committed = (size + ARENA_COMMIT_STEP - 1) / (ARENA_COMMIT_STEP) * (ARENA_COMMIT_STEP);
+
+    if (committed > block->capacity) committed = block->capacity;
+
+    // ENOMEM when the commit limit is hit, the block stays as it was
+    if (mprotect(block->data + block->committed, committed - block->committed, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+
+    block->committed = committed;
+
+    return true;
+}
+
+// Gives everything above first size bytes of the block back to the os.
 static inline
 void
-arena_resize(Arena* arena, u64 size) {
-    arena->data = (u8*)Arena_Realloc(arena->data, size);
-    Assert(arena->data, "Cannot resize arena.");
-    arena->capacity = size;
-}
\ No newline at end of file
+arena_decommit(Arena_Block* block, u64 size) {
+    u8* start  = block->data + size;
+    u64 length = block->committed - size;
+
+    madvise(start, length, MADV_DONTNEED);
+    mprotect(start, length, PROT_NONE);
+
+    block->committed = size;
+}
+#endif
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "allocator.h"
 #include "assert.h"
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 struct Array {
     T*         data;
     u64        length;
@@ -17,70 +17,69 @@ struct Array {
     const T* end()   const { return &data[length - 1]; }
 
     T& operator[](u64 i) {
-        Assert(i < count, "Index outside the bounds of the array");
+        Assert(i < length, "Index outside the bounds of the array");
         return data[i];
     }
 
     const T& operator[](u64 i) const {
-        Assert(i < count, "Index outside the bounds of the array");
+        Assert(i < length, "Index outside the bounds of the array");
         return data[i];
     }
 
-    Array(u64 length, Allocator* allocator = &Allocator_Std) : length(length),
+    Array(u64 length, Allocator* allocator = Alloc::get_default()) : length(length),
                                                                allocator(allocator) {
-        data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+        data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
         Assert(data, "Cannot allocate data for the array.");
     }
 
     ~Array() {
-        if (allocator == &Allocator_Temp) return;
-
-        allocator_free(allocator, data);
+        Alloc::free(allocator, data);
     }
 };
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 static inline
-Array<T>*
-array_make(u64 length, Allocator* allocator = &Allocator_Std);
+Array<T, Alloc>*
+array_make(u64 length, Allocator* allocator = Alloc::get_default());
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_realloc(Array<T>* array, u64 length);
+array_realloc(Array<T, Alloc>* array, u64 length);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_free(Array<T>* array);
+array_free(Array<T, Alloc>* array);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-array_get(Array<T>* array, u64 index);
+array_get(Array<T, Alloc>* array, u64 index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T*
-array_get_ptr(Array<T>* array, u64 index);
+array_get_ptr(Array<T, Alloc>* array, u64 index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_set(Array<T>* array, u64 index, T elem);
+array_set(Array<T, Alloc>* array, u64 index, T elem);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_clear(Array<T>* array);
+array_clear(Array<T, Alloc>* array);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
-Array<T>*
+Array<T, Alloc>*
 array_make(u64 length, Allocator* allocator) {
-    auto array = (Array<T>*)allocator_alloc(allocator, sizeof(Array<T>));
+    ALLOCATOR_TAG("array_make");
+    auto array = (Array<T, Alloc>*)Alloc::alloc(allocator, sizeof(Array<T, Alloc>), alignof(Array<T, Alloc>));
     Assert(array, "Cannot allocate array.");
-    auto data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+    auto data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
     Assert(data, "Cannot allocate data for the array.");
 
     array->data      = data;
@@ -90,66 +89,54 @@ array_make(u64 length, Allocator* allocator) {
     return array;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_realloc(Array<T>* array, u64 length) {
+array_realloc(Array<T, Alloc>* array, u64 length) {
+    ALLOCATOR_TAG("array_realloc");
     Assert(length > array->length, "Cannot resize array with less size.");
-    if (array->allocator == &Allocator_Temp) {
-        T* new_data = (T*)allocator_alloc(array->allocator, sizeof(T) * length);
-        Assert(new_data, "Cannot allocate enough memory for new array");
-
-        for (u64 i = 0; i < array->length; i++) {
-            new_data[i] = array->data[i];
-        }
-
-        array->data = new_data;
-    } else {
-        array->data = (T*)allocator_realloc(array->allocator, array->data, sizeof(T) * length);
-    }
 
+    array->data = (T*)Alloc::realloc(array->allocator, array->data, sizeof(T) * array->length, sizeof(T) * length, alignof(T));
     Assert(array->data, "Cannot realloc array");
     array->length = length;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_free(Array<T>* array) {
-    if (array->allocator == &Allocator_Temp) return;
-
-    allocator_free(array->allocator, array->data);
-    allocator_free(array->allocator, array);
+array_free(Array<T, Alloc>* array) {
+    Alloc::free(array->allocator, array->data);
+    Alloc::free(array->allocator, array);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-array_get(Array<T>* array, u64 index) {
+array_get(Array<T, Alloc>* array, u64 index) {
     Assert(index < array->length - 1, "Index outside bounds of the array.");
     return array->data[index];
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T*
-array_get_ptr(Array<T>* array, u64 index) {
+array_get_ptr(Array<T, Alloc>* array, u64 index) {
     Assert(index < array->length - 1, "Index outside bounds of the array.");
     return &array->data[index];
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_set(Array<T>* array, u64 index, T elem) {
+array_set(Array<T, Alloc>* array, u64 index, T elem) {
     Assert(index < array->length - 1, "Index outside bounds of the array.");
     array->data[index] = elem;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-array_clear(Array<T>* array) {
+array_clear(Array<T, Alloc>* array) {
     for (u64 i = 0; i < array->length; i++) {
         array->data[i] = {0};
     }
@@ -18,19 +18,52 @@
 #include "arena.h"
 
 static Allocator Allocator_Std = {
-    .alloc   = std_alloc,
-    .realloc = std_realloc,
-    .free    = std_free,
-    .context = null
+    .alloc         = std_alloc,
+    .alloc_aligned = std_alloc_aligned,
+    .realloc       = std_realloc,
+    .free          = std_free,
+    .context       = null
 };
 
-static Allocator Allocator_Temp = {
-    .alloc   = arena_alloc,
-    .realloc = arena_realloc,
-    .free    = arena_free,
-    .context = arena_make()
+#ifndef TEMP_ALLOCATOR_INITIAL_CAPACITY
+    #define TEMP_ALLOCATOR_INITIAL_CAPACITY ARENA_INITIAL_CAPACITY
+#endif
+
+/*
+    Every thread has its own temp arena. It's created on the first temp allocation of the thread
+    and destroyed when the thread exits, so nothing is allocated before main and threads never share it.
+    Temp functions are inline, not static, so all translation units share the same Allocator_Temp.
+*/
+inline void* temp_alloc(Allocator* allocator, u64 size);
+inline void* temp_alloc_aligned(Allocator* allocator, u64 size, u64 alignment);
+inline void* temp_realloc(Allocator* allocator, void* ptr, u64 size);
+inline void  temp_free(Allocator* allocator, void* ptr);
+
+inline thread_local Allocator Allocator_Temp = {
+    .alloc         = temp_alloc,
+    .alloc_aligned = temp_alloc_aligned,
+    .realloc       = temp_realloc,
+    .free          = temp_free,
+    .context       = null
+};
+
+// Used by the threads that didn't touch temp allocator yet.
+inline u64 Temp_Allocator_Initial_Capacity = TEMP_ALLOCATOR_INITIAL_CAPACITY;
+
+struct Temp_Arena_Owner {
+    Arena* arena;
+
+    ~Temp_Arena_Owner() {
+        if (arena) arena_destroy(arena);
+
+        // thread_local destructors that run after this one make a new arena instead of using the freed one
+        arena                  = null;
+        Allocator_Temp.context = null;
+    }
 };
 
+inline thread_local Temp_Arena_Owner Temp_Arena;
+
 static inline
 Allocator*
 get_std_allocator() {
@@ -43,8 +76,156 @@ get_temp_allocator() {
     return &Allocator_Temp;
 }
 
+static inline
+Arena*
+get_temp_arena() {
+    if (!Allocator_Temp.context) {
+        Temp_Arena.arena       = arena_make(Temp_Allocator_Initial_Capacity);
+        Allocator_Temp.context = Temp_Arena.arena;
+    }
+
+    return (Arena*)Allocator_Temp.context;
+}
+
+static inline
+void
+set_temp_allocator_initial_capacity(u64 capacity) {
+    Temp_Allocator_Initial_Capacity = capacity;
+}
+
 static inline
 void
 free_temp_allocator() {
     Allocator_Temp.free(&Allocator_Temp, null);
-}
\ No newline at end of file
+}
+
+// The allocator is the temp allocator of the thread that used it first, so it's either
+// already initialized or belongs to the calling thread.
+inline
+Arena*
+temp_arena(Allocator* allocator) {
+    if (allocator->context) return (Arena*)allocator->context;
+
+    return get_temp_arena();
+}
+
+inline
+void*
+temp_alloc(Allocator* allocator, u64 size) {
+    return arena_push(temp_arena(allocator), size);
+}
+
+inline
+void*
+temp_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    return arena_push(temp_arena(allocator), size, alignment);
+}
+
+inline
+void*
+temp_realloc(Allocator* allocator, void* ptr, u64 size) {
+    return arena_repush(temp_arena(allocator), ptr, size);
+}
+
+inline
+void
+temp_free(Allocator* allocator, void* ptr) {
+    Arena* arena = (Arena*)allocator->context;
+
+    // nothing to free if the thread never allocated
+    if (!arena) return;
+
+    if (ptr) {
+        arena_pop(arena, ptr);
+    } else {
+        arena_reset(arena);
+    }
+}
+
+/*
+    Allocation policies of the containers. Dynamic_Alloc calls the allocator through its function pointers,
+    Std_Alloc and Temp_Alloc call malloc and the temp arena directly, so allocations are inlined
+    into list_append, stack_push etc. and temp checks are resolved at compile time.
+    Containers keep the Allocator* with any policy, static policies ignore it.
+*/
+struct Dynamic_Alloc {
+    static inline
+    Allocator*
+    get_default() {
+        return &Allocator_Std;
+    }
+
+    static inline
+    void*
+    alloc(Allocator* allocator, u64 size, u64 alignment) {
+        return allocator_alloc_aligned(allocator, size, alignment);
+    }
+
+    static inline
+    void*
+    realloc(Allocator* allocator, void* ptr, u64 old_size, u64 new_size, u64 alignment) {
+        return allocator_realloc_aligned(allocator, ptr, old_size, new_size, alignment);
+    }
+
+    static inline
+    void
+    free(Allocator* allocator, void* ptr) {
+        // nothing to free if using Allocator_Temp
+        if (allocator == &Allocator_Temp) return;
+
+        allocator_free(allocator, ptr);
+    }
+};
+
+struct Std_Alloc {
+    static inline
+    Allocator*
+    get_default() {
+        return &Allocator_Std;
+    }
+
+    static inline
+    void*
+    alloc(Allocator* allocator, u64 size, u64 alignment) {
+        return std_alloc_aligned(allocator, size, alignment);
+    }
+
+    static inline
+    void*
+    realloc(Allocator* allocator, void* ptr, u64 old_size, u64 new_size, u64 alignment) {
+        if (alignment <= ALLOCATOR_DEFAULT_ALIGNMENT) return std_realloc(allocator, ptr, new_size);
+
+        return allocator_realloc_aligned(&Allocator_Std, ptr, old_size, new_size, alignment);
+    }
+
+    static inline
+    void
+    free(Allocator* allocator, void* ptr) {
+        std_free(allocator, ptr);
+    }
+};
+
+struct Temp_Alloc {
+    static inline
+    Allocator*
+    get_default() {
+        return &Allocator_Temp;
+    }
+
+    static inline
+    void*
+    alloc(Allocator* allocator, u64 size, u64 alignment) {
+        return arena_push(get_temp_arena(), size, alignment);
+    }
+
+    static inline
+    void*
+    realloc(Allocator* allocator, void* ptr, u64 old_size, u64 new_size, u64 alignment) {
+        return arena_repush(get_temp_arena(), ptr, new_size, alignment);
+    }
+
+    static inline
+    void
+    free(Allocator* allocator, void* ptr) {
+    }
+};
\ No newline at end of file
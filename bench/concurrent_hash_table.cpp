@@ -0,0 +1,174 @@
+/*
+    Stress test and throughput of Concurrent_Hash_Table.
+
+        g++ -std=c++20 -O2 -pthread -I.. concurrent_hash_table.cpp -o concurrent_hash_table
+        ./concurrent_hash_table [readers] [writers] [seconds]
+
+    Every writer owns its own keys and rewrites them round after round, removing a quarter of them each round.
+    The value carries the round and a check derived from the key and the round, so a reader that gets a value
+    written in half can tell. At the end every key must hold the value of the last round, or be removed by it.
+*/
+#include "../concurrent_hash_table.h"
+#include "../hash_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+
+#define BENCH_KEYS_PER_WRITER 100000
+
+struct Bench_Value {
+    u64 round;
+    u64 check;
+};
+
+using Bench_Table = Concurrent_Hash_Table<u64, Bench_Value>;
+
+struct Bench_Thread {
+    alignas(CACHE_LINE_SIZE) u64 operations;
+    u64 found;
+    u64 torn;
+    u64 rounds;
+};
+
+static bool bench_stop;
+
+static inline
+u64
+bench_check(u64 key, u64 round) {
+    return hash_u64(key ^ (round << 32));
+}
+
+static inline
+bool
+bench_removed(u64 key, u64 round) {
+    return (key + round) % 4 == 0;
+}
+
+static inline
+double
+bench_seconds() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static inline
+void
+bench_write(Bench_Table* table, u32 writer, Bench_Thread* stats) {
+    u64 first = (u64)writer * BENCH_KEYS_PER_WRITER;
+    u64 round = 0;
+
+    while (!__atomic_load_n(&bench_stop, __ATOMIC_RELAXED)) {
+        for (u64 key = first; key < first + BENCH_KEYS_PER_WRITER; key++) {
+            if (bench_removed(key, round)) {
+                concurrent_hash_table_remove(table, key);
+            } else {
+                concurrent_hash_table_add_or_set(table, key, { round, bench_check(key, round) });
+            }
+        }
+
+        stats->operations += BENCH_KEYS_PER_WRITER;
+        round++;
+    }
+
+    stats->rounds = round;
+}
+
+static inline
+void
+bench_read(Bench_Table* table, u32 writers, u32 reader, Bench_Thread* stats) {
+    u64 state = hash_u64(reader + 1);
+
+    while (!__atomic_load_n(&bench_stop, __ATOMIC_RELAXED)) {
+        for (u32 i = 0; i < 1024; i++) {
+            state = hash_u64(state);
+
+            u64         key = state % ((u64)writers * BENCH_KEYS_PER_WRITER);
+            Bench_Value value;
+
+            if (concurrent_hash_table_try_get(table, key, &value)) {
+                stats->found++;
+                if (value.check != bench_check(key, value.round)) stats->torn++;
+            }
+        }
+
+        stats->operations += 1024;
+    }
+}
+
+int
+main(int argc, char** argv) {
+    u32 readers = argc > 1 ? atoi(argv[1]) : 4;
+    u32 writers = argc > 2 ? atoi(argv[2]) : 4;
+    double seconds = argc > 3 ? atof(argv[3]) : 2.0;
+
+    // small on purpose, the shards grow and retire their arrays while readers probe them
+    auto table = concurrent_hash_table_make<u64, Bench_Value>(1024);
+
+    std::vector<Bench_Thread> stats(readers + writers);
+    std::vector<std::thread>  threads;
+
+    double start = bench_seconds();
+
+    for (u32 i = 0; i < writers; i++) threads.emplace_back(bench_write, table, i, &stats[i]);
+    for (u32 i = 0; i < readers; i++) threads.emplace_back(bench_read, table, writers, i, &stats[writers + i]);
+
+    while (bench_seconds() - start < seconds) {
+        timespec sleep = { 0, 10000000 };
+        nanosleep(&sleep, null);
+    }
+
+    __atomic_store_n(&bench_stop, true, __ATOMIC_RELAXED);
+    for (auto& thread : threads) thread.join();
+
+    double elapsed = bench_seconds() - start;
+
+    u64 writes = 0;
+    u64 reads  = 0;
+    u64 found  = 0;
+    u64 torn   = 0;
+    u64 lost   = 0;
+    u64 stale  = 0;
+
+    for (u32 i = 0; i < writers; i++) {
+        writes += stats[i].operations;
+
+        if (!stats[i].rounds) continue;
+
+        // the last finished round decides what every key of the writer holds
+        u64 round = stats[i].rounds - 1;
+        u64 first = (u64)i * BENCH_KEYS_PER_WRITER;
+
+        for (u64 key = first; key < first + BENCH_KEYS_PER_WRITER; key++) {
+            Bench_Value value;
+            bool        contains = concurrent_hash_table_try_get(table, key, &value);
+
+            if (bench_removed(key, round)) {
+                if (contains) stale++;
+            } else if (!contains) {
+                lost++;
+            } else if (value.round != round || value.check != bench_check(key, round)) {
+                stale++;
+            }
+        }
+    }
+
+    for (u32 i = writers; i < readers + writers; i++) {
+        reads += stats[i].operations;
+        found += stats[i].found;
+        torn  += stats[i].torn;
+    }
+
+    printf("%u readers, %u writers, %.2f s\n", readers, writers, elapsed);
+    printf("reads:  %.1f M/s (%.0f%% found)\n", reads / elapsed / 1e6, reads ? 100.0 * found / reads : 0.0);
+    printf("writes: %.1f M/s\n", writes / elapsed / 1e6);
+    printf("torn: %llu, lost: %llu, stale: %llu, count: %llu\n", (unsigned long long)torn, (unsigned long long)lost,
+           (unsigned long long)stale, (unsigned long long)concurrent_hash_table_count(table));
+
+    concurrent_hash_table_destroy(table);
+
+    return torn || lost || stale ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+    Batched lookups and inserts of Hash_Table against one key at a time.
+
+        g++ -std=c++20 -O2 -march=native -I.. hash_table_batch.cpp -o hash_table_batch
+        ./hash_table_batch [count] [lookups]
+
+    The table holds count random u64 keys, half of the lookups hit. Keep count well beyond the last level cache,
+    batching only helps when lookups miss the cache. Every case runs three times, the best time is printed.
+*/
+#include "../hash_table.h"
+#include "../hash_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_RUNS 3
+
+static inline
+double
+bench_seconds() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static inline
+void
+bench_print(const char* name, double seconds, u64 operations, u64 found) {
+    printf("%-24s %8.1f ms %8.1f ns/op  found %llu\n", name, seconds * 1e3, seconds * 1e9 / operations, (unsigned long long)found);
+}
+
+int
+main(int argc, char** argv) {
+    u32 count   = argc > 1 ? (u32)atoll(argv[1]) : 20000000;
+    u32 lookups = argc > 2 ? (u32)atoll(argv[2]) : 10000000;
+
+    u64*  keys    = (u64*)malloc(sizeof(u64) * count);
+    u64*  queries = (u64*)malloc(sizeof(u64) * lookups);
+    u64*  values  = (u64*)malloc(sizeof(u64) * lookups);
+    bool* found   = (bool*)malloc(sizeof(bool) * lookups);
+
+    for (u32 i = 0; i < count; i++) keys[i] = hash_u64(i);
+
+    // odd queries are never added
+    for (u32 i = 0; i < lookups; i++) {
+        u32 index  = (u32)(hash_u64(i ^ 0x5555) % count);
+        queries[i] = i % 2 ? hash_u64(index + (u64)count) : keys[index];
+    }
+
+    auto table = hash_table_make<u64, u64>();
+    for (u32 i = 0; i < count; i++) hash_table_add(table, keys[i], keys[i]);
+
+    printf("%u keys, %u lookups, table length %u\n", count, lookups, table->length);
+
+    double best[4] = { 1e9, 1e9, 1e9, 1e9 };
+    u64    hits[4] = {};
+
+    for (u32 run = 0; run < BENCH_RUNS; run++) {
+        double start = bench_seconds();
+        u64    hit   = 0;
+
+        for (u32 i = 0; i < lookups; i++) hit += hash_table_contains(table, queries[i]);
+
+        double seconds = bench_seconds() - start;
+        if (seconds < best[0]) best[0] = seconds;
+        hits[0] = hit;
+
+        start   = bench_seconds();
+        hit     = hash_table_contains_many(table, queries, lookups, found);
+        seconds = bench_seconds() - start;
+        if (seconds < best[1]) best[1] = seconds;
+        hits[1] = hit;
+
+        start = bench_seconds();
+        hit   = 0;
+
+        for (u32 i = 0; i < lookups; i++) {
+            u64* ptr = hash_table_get_ptr(table, queries[i]);
+            if (ptr) {
+                values[i] = *ptr;
+                hit++;
+            }
+        }
+
+        seconds = bench_seconds() - start;
+        if (seconds < best[2]) best[2] = seconds;
+        hits[2] = hit;
+
+        start   = bench_seconds();
+        hit     = hash_table_get_many(table, queries, lookups, values, found);
+        seconds = bench_seconds() - start;
+        if (seconds < best[3]) best[3] = seconds;
+        hits[3] = hit;
+    }
+
+    bench_print("contains loop", best[0], lookups, hits[0]);
+    bench_print("contains_many", best[1], lookups, hits[1]);
+    bench_print("get_ptr loop", best[2], lookups, hits[2]);
+    bench_print("get_many", best[3], lookups, hits[3]);
+
+    hash_table_free(table);
+
+    // inserts into a table that was reserved up front, so growth doesn't hide the misses
+    double add_best[2] = { 1e9, 1e9 };
+
+    for (u32 run = 0; run < BENCH_RUNS; run++) {
+        auto one = hash_table_make<u64, u64>(hash_table_length_for(count));
+
+        double start = bench_seconds();
+        for (u32 i = 0; i < count; i++) hash_table_add(one, keys[i], keys[i]);
+        double seconds = bench_seconds() - start;
+        if (seconds < add_best[0]) add_best[0] = seconds;
+
+        hash_table_free(one);
+
+        auto many = hash_table_make<u64, u64>(hash_table_length_for(count));
+
+        start = bench_seconds();
+        hash_table_add_many(many, keys, keys, count);
+        seconds = bench_seconds() - start;
+        if (seconds < add_best[1]) add_best[1] = seconds;
+
+        hash_table_free(many);
+    }
+
+    bench_print("add loop", add_best[0], count, count);
+    bench_print("add_many", add_best[1], count, count);
+
+    free(keys);
+    free(queries);
+    free(values);
+    free(found);
+
+    return 0;
+}
\ No newline at end of file
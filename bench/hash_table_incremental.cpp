@@ -0,0 +1,69 @@
+/*
+    Latency of single adds with and without HASH_TABLE_INCREMENTAL.
+
+        g++ -std=c++20 -O2 -march=native -I.. hash_table_incremental.cpp -o hash_table_incremental
+        ./hash_table_incremental [count]
+
+    Adds count random u64 keys to a table that starts small and times every add. A full rehash shows up as
+    one slow add, an incremental resize spreads the same work over the adds around it. The last run puts the
+    table into a virtual memory arena: malloc gives big blocks back to the os in free, which is the slowest
+    add left with the default allocator, the arena doesn't.
+*/
+#include "../hash_table.h"
+#include "../hash_functions.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline
+u64
+bench_nanoseconds() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (u64)time.tv_sec * 1000000000ull + (u64)time.tv_nsec;
+}
+
+static inline
+void
+bench_run(const char* name, u32 count, u32 flags, Allocator* allocator = Dynamic_Alloc::get_default()) {
+    auto table = hash_table_make<u64, u64>(HASH_TABLE_INITIAL_LENGTH, allocator, alignof(u64), flags);
+
+    u64 worst = 0;
+    u64 slow  = 0; // adds over 1 ms
+    u64 start = bench_nanoseconds();
+
+    for (u32 i = 0; i < count; i++) {
+        u64 before = bench_nanoseconds();
+        hash_table_add(table, hash_u64(i), (u64)i);
+        u64 elapsed = bench_nanoseconds() - before;
+
+        if (elapsed > worst)   worst = elapsed;
+        if (elapsed > 1000000) slow++;
+    }
+
+    u64 total = bench_nanoseconds() - start;
+
+    printf("%-20s total %8.1f ms  worst add %8.3f ms  adds over 1 ms %llu\n", name, total / 1e6, worst / 1e6, (unsigned long long)slow);
+
+    hash_table_free(table);
+}
+
+int
+main(int argc, char** argv) {
+    u32 count = argc > 1 ? (u32)atoll(argv[1]) : 20000000;
+
+    printf("%u keys\n", count);
+
+    bench_run("rehash", count, 0);
+    bench_run("incremental", count, HASH_TABLE_INCREMENTAL);
+
+    Arena*    arena     = arena_make_virtual();
+    Allocator allocator = arena_allocator_make(arena);
+
+    bench_run("incremental, arena", count, HASH_TABLE_INCREMENTAL, &allocator);
+
+    arena_destroy(arena);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,323 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <math.h>
+#include <memory.h>
+#include "hash_functions.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define BLOOM_FILTER_AVX2
+#endif
+
+#define BLOOM_FILTER_BLOCK_SIZE          64 // bytes, one cache line
+#define BLOOM_FILTER_BLOCK_WORDS         8  // u64 words in a block, a key sets one bit in each
+#define BLOOM_FILTER_BLOCK_BITS          512
+#define BLOOM_FILTER_FALSE_POSITIVE_RATE 0.01
+// Batch functions hash that many keys and prefetch their blocks, then test them.
+#define BLOOM_FILTER_BATCH_SIZE 16
+
+/*
+    Blocked Bloom filter: a key sets one bit in every u64 of one cache line sized block, so a lookup
+    touches one line. The block comes from the high bits of the hash, the bits come from the low 32 bits
+    multiplied by a salt per word (split block Bloom filter). With AVX2 the 8 bits are made and tested in two vectors.
+    The filter is sized for count keys and a false positive rate, adding more keys than that raises the rate.
+*/
+static const u32 BLOOM_FILTER_SALTS[8] = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31
+};
+
+template <typename Key, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash>
+struct Bloom_Filter {
+    u64*       blocks;
+    u32        block_count;
+    u32        count; // added keys
+    Allocator* allocator;
+
+    Bloom_Filter(u32 count, double false_positive_rate = BLOOM_FILTER_FALSE_POSITIVE_RATE, Allocator* allocator = Alloc::get_default());
+
+    ~Bloom_Filter() {
+        Alloc::free(allocator, blocks);
+    }
+};
+
+template <typename Key, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash>
+static inline
+Bloom_Filter<Key, Alloc, Hash>*
+bloom_filter_make(u32 count, double false_positive_rate = BLOOM_FILTER_FALSE_POSITIVE_RATE, Allocator* allocator = Alloc::get_default()); // Sized for count keys.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_free(Bloom_Filter<Key, Alloc, Hash>* filter);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_clear(Bloom_Filter<Key, Alloc, Hash>* filter);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_add(Bloom_Filter<Key, Alloc, Hash>* filter, Key key);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+bloom_filter_contains(Bloom_Filter<Key, Alloc, Hash>* filter, Key key); // False means the key was never added, true may be a false positive.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_add_many(Bloom_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+bloom_filter_contains_many(Bloom_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count, bool* found); // Returns number of keys that may be in the filter.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_allocate(Bloom_Filter<Key, Alloc, Hash>* filter, u32 count, double false_positive_rate);
+
+static inline
+u32
+bloom_filter_block_count(u32 count, double false_positive_rate); // Blocks for count keys at the rate.
+
+static inline
+double
+bloom_filter_false_positive_rate(double bits_per_key); // Expected rate of a filter with that many bits per key.
+
+static inline
+u64*
+bloom_filter_block(u64* blocks, u32 block_count, u64 hash);
+
+static inline
+void
+bloom_filter_insert_hash(u64* block, u64 hash);
+
+static inline
+bool
+bloom_filter_test_hash(const u64* block, u64 hash);
+
+// Implementation
+template <typename Key, typename Alloc, typename Hash>
+Bloom_Filter<Key, Alloc, Hash>::Bloom_Filter(u32 count, double false_positive_rate, Allocator* allocator) : allocator(allocator) {
+    bloom_filter_allocate(this, count, false_positive_rate);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+Bloom_Filter<Key, Alloc, Hash>*
+bloom_filter_make(u32 count, double false_positive_rate, Allocator* allocator) {
+    ALLOCATOR_TAG("bloom_filter_make");
+    auto filter = (Bloom_Filter<Key, Alloc, Hash>*)Alloc::alloc(allocator, sizeof(Bloom_Filter<Key, Alloc, Hash>), alignof(Bloom_Filter<Key, Alloc, Hash>));
+    Assert(filter, "Cannot allocate memory for bloom filter.");
+
+    filter->allocator = allocator;
+
+    bloom_filter_allocate(filter, count, false_positive_rate);
+
+    return filter;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_free(Bloom_Filter<Key, Alloc, Hash>* filter) {
+    Alloc::free(filter->allocator, filter->blocks);
+    Alloc::free(filter->allocator, filter);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_clear(Bloom_Filter<Key, Alloc, Hash>* filter) {
+    memset(filter->blocks, 0, (u64)filter->block_count * BLOOM_FILTER_BLOCK_SIZE);
+    filter->count = 0;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_add(Bloom_Filter<Key, Alloc, Hash>* filter, Key key) {
+    u64 hash = Hash::hash(key);
+
+    bloom_filter_insert_hash(bloom_filter_block(filter->blocks, filter->block_count, hash), hash);
+    filter->count++;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+bloom_filter_contains(Bloom_Filter<Key, Alloc, Hash>* filter, Key key) {
+    u64 hash = Hash::hash(key);
+
+    return bloom_filter_test_hash(bloom_filter_block(filter->blocks, filter->block_count, hash), hash);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_add_many(Bloom_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count) {
+    u64  hashes[BLOOM_FILTER_BATCH_SIZE];
+    u64* blocks[BLOOM_FILTER_BATCH_SIZE];
+
+    for (u32 batch = 0; batch < count; batch += BLOOM_FILTER_BATCH_SIZE) {
+        u32 size = count - batch < BLOOM_FILTER_BATCH_SIZE ? count - batch : BLOOM_FILTER_BATCH_SIZE;
+
+        for (u32 i = 0; i < size; i++) {
+            hashes[i] = Hash::hash(keys[batch + i]);
+            blocks[i] = bloom_filter_block(filter->blocks, filter->block_count, hashes[i]);
+            __builtin_prefetch(blocks[i], 1);
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            bloom_filter_insert_hash(blocks[i], hashes[i]);
+        }
+    }
+
+    filter->count += count;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+bloom_filter_contains_many(Bloom_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count, bool* found) {
+    u64  hashes[BLOOM_FILTER_BATCH_SIZE];
+    u64* blocks[BLOOM_FILTER_BATCH_SIZE];
+    u32  found_count = 0;
+
+    for (u32 batch = 0; batch < count; batch += BLOOM_FILTER_BATCH_SIZE) {
+        u32 size = count - batch < BLOOM_FILTER_BATCH_SIZE ? count - batch : BLOOM_FILTER_BATCH_SIZE;
+
+        for (u32 i = 0; i < size; i++) {
+            hashes[i] = Hash::hash(keys[batch + i]);
+            blocks[i] = bloom_filter_block(filter->blocks, filter->block_count, hashes[i]);
+            __builtin_prefetch(blocks[i]);
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            bool contains = bloom_filter_test_hash(blocks[i], hashes[i]);
+
+            found[batch + i] = contains;
+            found_count += contains;
+        }
+    }
+
+    return found_count;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+bloom_filter_allocate(Bloom_Filter<Key, Alloc, Hash>* filter, u32 count, double false_positive_rate) {
+    filter->block_count = bloom_filter_block_count(count, false_positive_rate);
+    filter->count       = 0;
+
+    filter->blocks = (u64*)Alloc::alloc(filter->allocator, (u64)filter->block_count * BLOOM_FILTER_BLOCK_SIZE, BLOOM_FILTER_BLOCK_SIZE);
+    Assert(filter->blocks, "Cannot allocate memory for bloom filter blocks.");
+
+    memset(filter->blocks, 0, (u64)filter->block_count * BLOOM_FILTER_BLOCK_SIZE);
+}
+
+static inline
+u32
+bloom_filter_block_count(u32 count, double false_positive_rate) {
+    Assert(false_positive_rate > 0 && false_positive_rate < 1, "False positive rate must be between 0 and 1.");
+
+    // quarters of a bit per key, up to 64 bits, where 8 bits per key stop getting better
+    double bits_per_key = 4;
+    while (bits_per_key < 64 && bloom_filter_false_positive_rate(bits_per_key) > false_positive_rate) {
+        bits_per_key += 0.25;
+    }
+
+    u64 blocks = (u64)ceil(count * bits_per_key / BLOOM_FILTER_BLOCK_BITS);
+
+    return blocks > 0 ? (u32)blocks : 1;
+}
+
+static inline
+double
+bloom_filter_false_positive_rate(double bits_per_key) {
+    // keys per block are poisson distributed, a block with i keys fails a word with (1 - (1 - 1/64)^i)
+    double keys        = BLOOM_FILTER_BLOCK_BITS / bits_per_key;
+    double probability = exp(-keys);
+    double word_free   = 1;
+    double rate        = 0;
+
+    for (u32 i = 0; i < keys * 2 + 64; i++) {
+        rate        += probability * pow(1 - word_free, BLOOM_FILTER_BLOCK_WORDS);
+        probability *= keys / (i + 1);
+        word_free   *= 1 - 1.0 / 64;
+    }
+
+    return rate;
+}
+
+static inline
+u64*
+bloom_filter_block(u64* blocks, u32 block_count, u64 hash) {
+    u64 block = (u64)(((__uint128_t)hash * block_count) >> 64);
+
+    return &blocks[block * BLOOM_FILTER_BLOCK_WORDS];
+}
+
+#ifdef BLOOM_FILTER_AVX2
+static inline
+void
+bloom_filter_masks(u64 hash, __m256i* low, __m256i* high) {
+    __m256i salts = _mm256_loadu_si256((const __m256i*)BLOOM_FILTER_SALTS);
+    __m256i bits  = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((u32)hash), salts), 26);
+    __m256i one   = _mm256_set1_epi64x(1);
+
+    *low  = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+    *high = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+}
+
+static inline
+void
+bloom_filter_insert_hash(u64* block, u64 hash) {
+    __m256i low;
+    __m256i high;
+    bloom_filter_masks(hash, &low, &high);
+
+    _mm256_store_si256((__m256i*)block,     _mm256_or_si256(_mm256_load_si256((__m256i*)block), low));
+    _mm256_store_si256((__m256i*)block + 1, _mm256_or_si256(_mm256_load_si256((__m256i*)block + 1), high));
+}
+
+static inline
+bool
+bloom_filter_test_hash(const u64* block, u64 hash) {
+    __m256i low;
+    __m256i high;
+    bloom_filter_masks(hash, &low, &high);
+
+    // testc is 1 when every bit of the mask is set in the block
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i*)block), low)
+         & _mm256_testc_si256(_mm256_load_si256((const __m256i*)block + 1), high);
+}
+#else
+static inline
+void
+bloom_filter_insert_hash(u64* block, u64 hash) {
+    for (u32 i = 0; i < BLOOM_FILTER_BLOCK_WORDS; i++) {
+        block[i] |= 1ull << (((u32)hash * BLOOM_FILTER_SALTS[i]) >> 26);
+    }
+}
+
+static inline
+bool
+bloom_filter_test_hash(const u64* block, u64 hash) {
+    u64 missing = 0;
+
+    for (u32 i = 0; i < BLOOM_FILTER_BLOCK_WORDS; i++) {
+        missing |= ~block[i] & (1ull << (((u32)hash * BLOOM_FILTER_SALTS[i]) >> 26));
+    }
+
+    return missing == 0;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,471 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include "hash_table.h"
+#include <malloc.h>
+#include <string.h>
+#include <type_traits>
+
+#define CONCURRENT_HASH_TABLE_SHARDS 64
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define CONCURRENT_HASH_TABLE_PAUSE() __builtin_ia32_pause()
+#else
+    #define CONCURRENT_HASH_TABLE_PAUSE()
+#endif
+
+/*
+    Hash table for many threads. Keys are split into shards by the highest bits of the hash,
+    every shard is a Hash_Table guarded by a seqlock. Writers take the lock by making the sequence odd.
+    Readers don't write anything: they remember the sequence, probe the arrays and retry if the sequence has changed.
+
+    Readers may probe arrays that a writer has just replaced, so the shard's tables never free their arrays,
+    they are retired and freed by concurrent_hash_table_reclaim or destroy. Call reclaim when no thread reads the table.
+    Readers may also see keys and values in the middle of a write, so both must be trivially copyable,
+    and Equal must not follow pointers (don't use String_Equal here). Readers load control bytes, keys and values
+    with relaxed atomics, a torn copy is thrown away when the sequence check fails.
+*/
+struct Concurrent_Hash_Table_Retired {
+    Concurrent_Hash_Table_Retired* next;
+};
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+struct alignas(CACHE_LINE_SIZE) Concurrent_Hash_Table_Shard {
+    u64                                                 sequence; // odd while a writer holds the shard
+    Hash_Table<Key, Value, Dynamic_Alloc, Hash, Equal>* table;
+    Allocator                                           allocator; // retires instead of freeing
+    Concurrent_Hash_Table_Retired*                      retired;
+};
+
+template <typename Key, typename Value, typename Hash = Default_Hash, typename Equal = Default_Equal>
+struct Concurrent_Hash_Table {
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "Readers copy keys and values without locks.");
+
+    Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>* shards;
+    u32                                                   shard_count;
+    u32                                                   shard_shift; // hash >> shard_shift is the shard index
+};
+
+template <typename Key, typename Value, typename Hash = Default_Hash, typename Equal = Default_Equal>
+static inline
+Concurrent_Hash_Table<Key, Value, Hash, Equal>*
+concurrent_hash_table_make(u32 length = HASH_TABLE_INITIAL_LENGTH, u32 shard_count = CONCURRENT_HASH_TABLE_SHARDS); // length is split between shards, shard_count must be a power of 2.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_destroy(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table);
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_reclaim(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table); // Frees retired arrays. No thread may read the table during the call.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_try_get(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Value* value); // Lock free.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_contains(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key); // Lock free.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_add_or_set(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Value value); // Returns true if the key was already there.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_find_or_insert(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Value value, Value* result); // Adds value if the key is not there. Copies the value of the key into result and returns true if it was added. Returns false and leaves result as is if the shard is full.
+
+template <typename Key, typename Value, typename Hash, typename Equal, typename Update>
+static inline
+bool
+concurrent_hash_table_update(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Update update); // Calls update(Value* value, bool inserted) under the shard lock, new values are zero initialized. Returns inserted. Doesn't call update if the shard is full.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_remove(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key); // Returns true if the key was removed.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+u64
+concurrent_hash_table_count(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table); // Approximate while writers are running.
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>*
+concurrent_hash_table_shard(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, u64 hash);
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_lock(Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>* shard);
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_unlock(Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>* shard);
+
+template <typename Key, typename Equal>
+static inline
+u32
+concurrent_hash_table_probe(const u8* control, const Key* keys, u32 length, Key key, u64 hash); // hash_table_probe for readers, loads the arrays with relaxed atomics.
+
+template <typename T>
+static inline
+T
+concurrent_hash_table_read(const T* ptr); // Copies the value with relaxed atomic loads, the copy may be torn.
+
+template <typename Word>
+static inline
+void
+concurrent_hash_table_copy(void* destination, const void* source, u64 size); // size is a multiple of sizeof(Word), source is aligned to it.
+
+static inline
+void*
+concurrent_hash_table_alloc(Allocator* allocator, u64 size);
+
+static inline
+void*
+concurrent_hash_table_alloc_aligned(Allocator* allocator, u64 size, u64 alignment);
+
+static inline
+void*
+concurrent_hash_table_realloc(Allocator* allocator, void* ptr, u64 size); // Hash_Table never reallocates its arrays, asserts.
+
+static inline
+void
+concurrent_hash_table_retire(Allocator* allocator, void* ptr); // Free function of the shard's allocator.
+
+// Implementation
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+Concurrent_Hash_Table<Key, Value, Hash, Equal>*
+concurrent_hash_table_make(u32 length, u32 shard_count) {
+    Assert(shard_count && (shard_count & (shard_count - 1)) == 0, "Shard count must be a power of 2.");
+
+    auto table = (Concurrent_Hash_Table<Key, Value, Hash, Equal>*)malloc(sizeof(Concurrent_Hash_Table<Key, Value, Hash, Equal>));
+    Assert(table, "Cannot allocate concurrent hash table.");
+
+    u64 size      = sizeof(Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>) * shard_count;
+    table->shards = (Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>*)std_alloc_aligned(null, size, CACHE_LINE_SIZE);
+    Assert(table->shards, "Cannot allocate concurrent hash table shards.");
+
+    table->shard_count = shard_count;
+    table->shard_shift = 64 - __builtin_ctz(shard_count);
+
+    for (u32 i = 0; i < shard_count; i++) {
+        auto shard = &table->shards[i];
+
+        shard->sequence  = 0;
+        shard->retired   = null;
+        shard->allocator = {
+            .alloc         = concurrent_hash_table_alloc,
+            .alloc_aligned = concurrent_hash_table_alloc_aligned,
+            .realloc       = concurrent_hash_table_realloc,
+            .free          = concurrent_hash_table_retire,
+            .context       = &shard->retired
+        };
+        shard->table = hash_table_make<Key, Value, Dynamic_Alloc, Hash, Equal>(length / shard_count, &shard->allocator);
+    }
+
+    return table;
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_destroy(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table) {
+    for (u32 i = 0; i < table->shard_count; i++) {
+        hash_table_free(table->shards[i].table);
+    }
+
+    concurrent_hash_table_reclaim(table);
+
+    std_free(null, table->shards);
+    free(table);
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_reclaim(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table) {
+    for (u32 i = 0; i < table->shard_count; i++) {
+        auto shard = &table->shards[i];
+
+        concurrent_hash_table_lock(shard);
+        Concurrent_Hash_Table_Retired* retired = shard->retired;
+        shard->retired = null;
+        concurrent_hash_table_unlock(shard);
+
+        while (retired) {
+            Concurrent_Hash_Table_Retired* next = retired->next;
+            std_free(null, retired);
+            retired = next;
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_try_get(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Value* value) {
+    u64  hash  = Hash::hash(key);
+    auto shard = concurrent_hash_table_shard(table, hash);
+    auto t     = shard->table;
+
+    while (true) {
+        u64 sequence = __atomic_load_n(&shard->sequence, __ATOMIC_ACQUIRE);
+
+        if (sequence & 1) {
+            CONCURRENT_HASH_TABLE_PAUSE();
+            continue;
+        }
+
+        u8*    control = __atomic_load_n(&t->control, __ATOMIC_RELAXED);
+        Key*   keys    = __atomic_load_n(&t->keys, __ATOMIC_RELAXED);
+        Value* values  = __atomic_load_n(&t->values, __ATOMIC_RELAXED);
+        u32    length  = __atomic_load_n(&t->length, __ATOMIC_RELAXED);
+
+        // the arrays and the length must belong to the same table before probing them
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shard->sequence, __ATOMIC_RELAXED) != sequence) continue;
+
+        u32   index  = concurrent_hash_table_probe<Key, Equal>(control, keys, length, key, hash);
+        Value result = index != HASH_TABLE_NOT_FOUND ? concurrent_hash_table_read(&values[index]) : Value();
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shard->sequence, __ATOMIC_RELAXED) != sequence) continue;
+
+        if (index == HASH_TABLE_NOT_FOUND) return false;
+
+        *value = result;
+
+        return true;
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_contains(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key) {
+    Value value;
+
+    return concurrent_hash_table_try_get(table, key, &value);
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_add_or_set(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Value value) {
+    auto shard = concurrent_hash_table_shard(table, Hash::hash(key));
+
+    concurrent_hash_table_lock(shard);
+    bool found = hash_table_add_or_set(shard->table, key, value);
+    concurrent_hash_table_unlock(shard);
+
+    return found;
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_find_or_insert(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Value value, Value* result) {
+    auto shard = concurrent_hash_table_shard(table, Hash::hash(key));
+    bool inserted;
+
+    concurrent_hash_table_lock(shard);
+
+    Value* ptr = hash_table_find_or_insert(shard->table, key, &inserted);
+
+    if (ptr) {
+        if (inserted) *ptr = value;
+        if (result)   *result = *ptr;
+    }
+
+    concurrent_hash_table_unlock(shard);
+
+    return inserted;
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal, typename Update>
+static inline
+bool
+concurrent_hash_table_update(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key, Update update) {
+    auto shard = concurrent_hash_table_shard(table, Hash::hash(key));
+    bool inserted;
+
+    concurrent_hash_table_lock(shard);
+
+    Value* ptr = hash_table_find_or_insert(shard->table, key, &inserted);
+    if (ptr) update(ptr, inserted);
+
+    concurrent_hash_table_unlock(shard);
+
+    return inserted;
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+bool
+concurrent_hash_table_remove(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, Key key) {
+    auto shard = concurrent_hash_table_shard(table, Hash::hash(key));
+
+    concurrent_hash_table_lock(shard);
+    bool removed = hash_table_remove_if_contains(shard->table, key);
+    concurrent_hash_table_unlock(shard);
+
+    return removed;
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+u64
+concurrent_hash_table_count(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table) {
+    u64 count = 0;
+
+    for (u32 i = 0; i < table->shard_count; i++) {
+        count += __atomic_load_n(&table->shards[i].table->count, __ATOMIC_RELAXED);
+    }
+
+    return count;
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>*
+concurrent_hash_table_shard(Concurrent_Hash_Table<Key, Value, Hash, Equal>* table, u64 hash) {
+    // the table inside of the shard uses the low bits
+    return &table->shards[table->shard_count == 1 ? 0 : hash >> table->shard_shift];
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_lock(Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>* shard) {
+    while (true) {
+        u64 sequence = __atomic_load_n(&shard->sequence, __ATOMIC_RELAXED);
+
+        if (!(sequence & 1) && __atomic_compare_exchange_n(&shard->sequence, &sequence, sequence + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            // the odd sequence must be visible before any write to the table, a reader that sees
+            // the write sees the odd sequence too and retries (acquire alone lets the writes move up)
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            return;
+        }
+
+        CONCURRENT_HASH_TABLE_PAUSE();
+    }
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal>
+static inline
+void
+concurrent_hash_table_unlock(Concurrent_Hash_Table_Shard<Key, Value, Hash, Equal>* shard) {
+    __atomic_fetch_add(&shard->sequence, 1, __ATOMIC_RELEASE);
+}
+
+template <typename Key, typename Equal>
+static inline
+u32
+concurrent_hash_table_probe(const u8* control, const Key* keys, u32 length, Key key, u64 hash) {
+    u32 mask  = length / HASH_TABLE_GROUP_WIDTH - 1;
+    u32 group = (u32)(hash >> 7) & mask;
+    u8  h2    = hash & 0x7F;
+
+    for (u32 probe = 1; probe <= mask + 1; probe++) {
+        u32 start = group * HASH_TABLE_GROUP_WIDTH;
+        u64 ctrl[HASH_TABLE_GROUP_WIDTH / sizeof(u64)];
+
+        // groups are aligned, the first one is at the start of the allocation
+        concurrent_hash_table_copy<u64>(ctrl, &control[start], HASH_TABLE_GROUP_WIDTH);
+
+        u32 match = hash_table_group_match((const u8*)ctrl, h2);
+
+        while (match) {
+            u32 index = start + __builtin_ctz(match);
+
+            if (Equal::equal(concurrent_hash_table_read(&keys[index]), key)) return index;
+
+            match &= match - 1;
+        }
+
+        if (hash_table_group_match_empty((const u8*)ctrl)) break;
+
+        group = (group + probe) & mask;
+    }
+
+    return HASH_TABLE_NOT_FOUND;
+}
+
+template <typename T>
+static inline
+T
+concurrent_hash_table_read(const T* ptr) {
+    T result;
+
+    if constexpr (sizeof(T) % sizeof(u64) == 0 && alignof(T) >= alignof(u64)) {
+        concurrent_hash_table_copy<u64>(&result, ptr, sizeof(T));
+    } else if constexpr (sizeof(T) % sizeof(u32) == 0 && alignof(T) >= alignof(u32)) {
+        concurrent_hash_table_copy<u32>(&result, ptr, sizeof(T));
+    } else if constexpr (sizeof(T) % sizeof(u16) == 0 && alignof(T) >= alignof(u16)) {
+        concurrent_hash_table_copy<u16>(&result, ptr, sizeof(T));
+    } else {
+        concurrent_hash_table_copy<u8>(&result, ptr, sizeof(T));
+    }
+
+    return result;
+}
+
+template <typename Word>
+static inline
+void
+concurrent_hash_table_copy(void* destination, const void* source, u64 size) {
+    Word*       dst = (Word*)destination;
+    const Word* src = (const Word*)source;
+
+    for (u64 i = 0; i < size / sizeof(Word); i++) {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+}
+
+static inline
+void*
+concurrent_hash_table_alloc(Allocator* allocator, u64 size) {
+    return std_alloc(allocator, size);
+}
+
+static inline
+void*
+concurrent_hash_table_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    return std_alloc_aligned(allocator, size, alignment);
+}
+
+static inline
+void*
+concurrent_hash_table_realloc(Allocator* allocator, void* ptr, u64 size) {
+    Assert(false, "Cannot realloc memory of concurrent hash table, readers may still use it.");
+
+    return null;
+}
+
+static inline
+void
+concurrent_hash_table_retire(Allocator* allocator, void* ptr) {
+    if (!ptr) return;
+
+    // the shard is locked, writers are the only ones who free. Readers that still probe the block
+    // will see the link instead of control bytes and retry, because the sequence has changed.
+    auto retired = (Concurrent_Hash_Table_Retired*)ptr;
+    auto head    = (Concurrent_Hash_Table_Retired**)allocator->context;
+
+    retired->next = *head;
+    *head         = retired;
+}
\ No newline at end of file
@@ -0,0 +1,447 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <memory.h>
+#include "hash_functions.h"
+
+#define CUCKOO_FILTER_SLOTS               4  // fingerprints in a bucket
+#define CUCKOO_FILTER_MAX_LOAD_FACTOR     95
+#define CUCKOO_FILTER_MAX_KICKS           500
+#define CUCKOO_FILTER_FALSE_POSITIVE_RATE 0.01
+// Batch functions hash that many keys and prefetch both of their buckets, then test them.
+#define CUCKOO_FILTER_BATCH_SIZE 16
+
+/*
+    Cuckoo filter keeps a fingerprint of every key in one of two buckets of 4 slots, the second bucket is
+    the first one xor the hash of the fingerprint, so a fingerprint can be moved without its key.
+    Unlike Bloom_Filter, keys can be removed, but only keys that were added: removing anything else may remove
+    a fingerprint of another key. A lookup reads two buckets and compares all 4 slots at once (SWAR).
+
+    Fingerprints are 8 bits if the false positive rate allows it (2 * 4 / 2^8, about 3%), 16 bits otherwise,
+    so rates below 2 * 4 / 2^16 (about 0.012%) are not reached. When an add doesn't find a place after
+    CUCKOO_FILTER_MAX_KICKS moves, the last moved fingerprint is kept aside and the filter is full.
+*/
+template <typename Key, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash>
+struct Cuckoo_Filter {
+    u8*        buckets;
+    u32        bucket_count;     // power of 2
+    u32        fingerprint_size; // 1 or 2 bytes
+    u32        count;
+    u32        victim;           // fingerprint that didn't fit, 0 if none
+    u32        victim_bucket;
+    u64        random;           // xorshift state for picking slots to kick
+    Allocator* allocator;
+
+    Cuckoo_Filter(u32 count, double false_positive_rate = CUCKOO_FILTER_FALSE_POSITIVE_RATE, Allocator* allocator = Alloc::get_default());
+
+    ~Cuckoo_Filter() {
+        Alloc::free(allocator, buckets);
+    }
+};
+
+template <typename Key, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash>
+static inline
+Cuckoo_Filter<Key, Alloc, Hash>*
+cuckoo_filter_make(u32 count, double false_positive_rate = CUCKOO_FILTER_FALSE_POSITIVE_RATE, Allocator* allocator = Alloc::get_default()); // Sized for count keys.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_free(Cuckoo_Filter<Key, Alloc, Hash>* filter);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_clear(Cuckoo_Filter<Key, Alloc, Hash>* filter);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_add(Cuckoo_Filter<Key, Alloc, Hash>* filter, Key key); // Returns false if the filter is full.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_contains(Cuckoo_Filter<Key, Alloc, Hash>* filter, Key key); // False means the key is not in the filter, true may be a false positive.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_remove(Cuckoo_Filter<Key, Alloc, Hash>* filter, Key key); // Returns true if a fingerprint of the key was removed.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_add_many(Cuckoo_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count); // Returns number of added keys, less than count if the filter got full.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_contains_many(Cuckoo_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count, bool* found); // Returns number of keys that may be in the filter.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_allocate(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 count, double false_positive_rate);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_insert(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 fingerprint, u32 bucket);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_lookup(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 fingerprint, u32 bucket);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_fingerprint(Cuckoo_Filter<Key, Alloc, Hash>* filter, u64 hash); // Never 0, 0 is an empty slot.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_bucket(Cuckoo_Filter<Key, Alloc, Hash>* filter, u64 hash);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_alternate(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 fingerprint); // The other bucket of the fingerprint, works both ways.
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_bucket_contains(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 fingerprint);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_get(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 slot);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_set(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 slot, u32 fingerprint);
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_put(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 fingerprint); // Puts the fingerprint into an empty slot of the bucket. Returns false if there is none.
+
+// Implementation
+template <typename Key, typename Alloc, typename Hash>
+Cuckoo_Filter<Key, Alloc, Hash>::Cuckoo_Filter(u32 count, double false_positive_rate, Allocator* allocator) : allocator(allocator) {
+    cuckoo_filter_allocate(this, count, false_positive_rate);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+Cuckoo_Filter<Key, Alloc, Hash>*
+cuckoo_filter_make(u32 count, double false_positive_rate, Allocator* allocator) {
+    ALLOCATOR_TAG("cuckoo_filter_make");
+    auto filter = (Cuckoo_Filter<Key, Alloc, Hash>*)Alloc::alloc(allocator, sizeof(Cuckoo_Filter<Key, Alloc, Hash>), alignof(Cuckoo_Filter<Key, Alloc, Hash>));
+    Assert(filter, "Cannot allocate memory for cuckoo filter.");
+
+    filter->allocator = allocator;
+
+    cuckoo_filter_allocate(filter, count, false_positive_rate);
+
+    return filter;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_free(Cuckoo_Filter<Key, Alloc, Hash>* filter) {
+    Alloc::free(filter->allocator, filter->buckets);
+    Alloc::free(filter->allocator, filter);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_clear(Cuckoo_Filter<Key, Alloc, Hash>* filter) {
+    memset(filter->buckets, 0, (u64)filter->bucket_count * CUCKOO_FILTER_SLOTS * filter->fingerprint_size);
+    filter->count  = 0;
+    filter->victim = 0;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_add(Cuckoo_Filter<Key, Alloc, Hash>* filter, Key key) {
+    u64 hash = Hash::hash(key);
+
+    return cuckoo_filter_insert(filter, cuckoo_filter_fingerprint(filter, hash), cuckoo_filter_bucket(filter, hash));
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_contains(Cuckoo_Filter<Key, Alloc, Hash>* filter, Key key) {
+    u64 hash = Hash::hash(key);
+
+    return cuckoo_filter_lookup(filter, cuckoo_filter_fingerprint(filter, hash), cuckoo_filter_bucket(filter, hash));
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_remove(Cuckoo_Filter<Key, Alloc, Hash>* filter, Key key) {
+    u64 hash        = Hash::hash(key);
+    u32 fingerprint = cuckoo_filter_fingerprint(filter, hash);
+    u32 first       = cuckoo_filter_bucket(filter, hash);
+    u32 second      = cuckoo_filter_alternate(filter, first, fingerprint);
+
+    if (filter->victim == fingerprint && (filter->victim_bucket == first || filter->victim_bucket == second)) {
+        filter->victim = 0;
+        filter->count--;
+        return true;
+    }
+
+    u32 buckets[2] = { first, second };
+
+    for (u32 b = 0; b < 2; b++) {
+        for (u32 slot = 0; slot < CUCKOO_FILTER_SLOTS; slot++) {
+            if (cuckoo_filter_get(filter, buckets[b], slot) != fingerprint) continue;
+
+            cuckoo_filter_set(filter, buckets[b], slot, 0);
+            filter->count--;
+
+            // there is room now, try to put the fingerprint that didn't fit back
+            if (filter->victim) {
+                u32 victim = filter->victim;
+
+                filter->victim = 0;
+                filter->count--;
+                cuckoo_filter_insert(filter, victim, filter->victim_bucket);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_add_many(Cuckoo_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count) {
+    u32 fingerprints[CUCKOO_FILTER_BATCH_SIZE];
+    u32 buckets[CUCKOO_FILTER_BATCH_SIZE];
+    u32 added = 0;
+    u32 size  = filter->fingerprint_size * CUCKOO_FILTER_SLOTS;
+
+    for (u32 batch = 0; batch < count; batch += CUCKOO_FILTER_BATCH_SIZE) {
+        u32 batch_size = count - batch < CUCKOO_FILTER_BATCH_SIZE ? count - batch : CUCKOO_FILTER_BATCH_SIZE;
+
+        for (u32 i = 0; i < batch_size; i++) {
+            u64 hash = Hash::hash(keys[batch + i]);
+
+            fingerprints[i] = cuckoo_filter_fingerprint(filter, hash);
+            buckets[i]      = cuckoo_filter_bucket(filter, hash);
+            __builtin_prefetch(&filter->buckets[(u64)buckets[i] * size], 1);
+            __builtin_prefetch(&filter->buckets[(u64)cuckoo_filter_alternate(filter, buckets[i], fingerprints[i]) * size], 1);
+        }
+
+        for (u32 i = 0; i < batch_size; i++) {
+            if (!cuckoo_filter_insert(filter, fingerprints[i], buckets[i])) return added;
+            added++;
+        }
+    }
+
+    return added;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_contains_many(Cuckoo_Filter<Key, Alloc, Hash>* filter, const Key* keys, u32 count, bool* found) {
+    u32 fingerprints[CUCKOO_FILTER_BATCH_SIZE];
+    u32 buckets[CUCKOO_FILTER_BATCH_SIZE];
+    u32 found_count = 0;
+    u32 size        = filter->fingerprint_size * CUCKOO_FILTER_SLOTS;
+
+    for (u32 batch = 0; batch < count; batch += CUCKOO_FILTER_BATCH_SIZE) {
+        u32 batch_size = count - batch < CUCKOO_FILTER_BATCH_SIZE ? count - batch : CUCKOO_FILTER_BATCH_SIZE;
+
+        for (u32 i = 0; i < batch_size; i++) {
+            u64 hash = Hash::hash(keys[batch + i]);
+
+            fingerprints[i] = cuckoo_filter_fingerprint(filter, hash);
+            buckets[i]      = cuckoo_filter_bucket(filter, hash);
+            __builtin_prefetch(&filter->buckets[(u64)buckets[i] * size]);
+            __builtin_prefetch(&filter->buckets[(u64)cuckoo_filter_alternate(filter, buckets[i], fingerprints[i]) * size]);
+        }
+
+        for (u32 i = 0; i < batch_size; i++) {
+            bool contains = cuckoo_filter_lookup(filter, fingerprints[i], buckets[i]);
+
+            found[batch + i] = contains;
+            found_count += contains;
+        }
+    }
+
+    return found_count;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_allocate(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 count, double false_positive_rate) {
+    Assert(false_positive_rate > 0 && false_positive_rate < 1, "False positive rate must be between 0 and 1.");
+
+    u64 slots = ((u64)count * 100 + CUCKOO_FILTER_MAX_LOAD_FACTOR - 1) / CUCKOO_FILTER_MAX_LOAD_FACTOR;
+
+    u32 bucket_count = 2;
+    while ((u64)bucket_count * CUCKOO_FILTER_SLOTS < slots) bucket_count *= 2;
+
+    filter->bucket_count     = bucket_count;
+    filter->fingerprint_size = 2.0 * CUCKOO_FILTER_SLOTS / 256 <= false_positive_rate ? 1 : 2;
+    filter->count            = 0;
+    filter->victim           = 0;
+    filter->victim_bucket    = 0;
+    filter->random           = HASH_SECRET_0;
+
+    u64 size = (u64)bucket_count * CUCKOO_FILTER_SLOTS * filter->fingerprint_size;
+
+    filter->buckets = (u8*)Alloc::alloc(filter->allocator, size, CACHE_LINE_SIZE);
+    Assert(filter->buckets, "Cannot allocate memory for cuckoo filter buckets.");
+
+    memset(filter->buckets, 0, size);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_insert(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 fingerprint, u32 bucket) {
+    if (filter->victim) {
+        return false;
+    }
+
+    if (cuckoo_filter_put(filter, bucket, fingerprint)) {
+        filter->count++;
+        return true;
+    }
+
+    bucket = cuckoo_filter_alternate(filter, bucket, fingerprint);
+
+    for (u32 kick = 0; kick < CUCKOO_FILTER_MAX_KICKS; kick++) {
+        if (cuckoo_filter_put(filter, bucket, fingerprint)) {
+            filter->count++;
+            return true;
+        }
+
+        filter->random ^= filter->random << 13;
+        filter->random ^= filter->random >> 7;
+        filter->random ^= filter->random << 17;
+
+        // swap with a random fingerprint of the full bucket and move that one to its other bucket
+        u32 slot    = (u32)(filter->random % CUCKOO_FILTER_SLOTS);
+        u32 evicted = cuckoo_filter_get(filter, bucket, slot);
+
+        cuckoo_filter_set(filter, bucket, slot, fingerprint);
+
+        fingerprint = evicted;
+        bucket      = cuckoo_filter_alternate(filter, bucket, fingerprint);
+    }
+
+    // the key is in the filter, but the filter is full
+    filter->victim        = fingerprint;
+    filter->victim_bucket = bucket;
+    filter->count++;
+
+    return true;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_lookup(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 fingerprint, u32 bucket) {
+    u32 second = cuckoo_filter_alternate(filter, bucket, fingerprint);
+
+    if (filter->victim == fingerprint && (filter->victim_bucket == bucket || filter->victim_bucket == second)) {
+        return true;
+    }
+
+    return cuckoo_filter_bucket_contains(filter, bucket, fingerprint) || cuckoo_filter_bucket_contains(filter, second, fingerprint);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_fingerprint(Cuckoo_Filter<Key, Alloc, Hash>* filter, u64 hash) {
+    u32 fingerprint = (u32)hash & ((1u << (filter->fingerprint_size * 8)) - 1);
+
+    return fingerprint ? fingerprint : 1;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_bucket(Cuckoo_Filter<Key, Alloc, Hash>* filter, u64 hash) {
+    return (u32)(hash >> 32) & (filter->bucket_count - 1);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_alternate(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 fingerprint) {
+    return (bucket ^ (u32)hash_u64(fingerprint)) & (filter->bucket_count - 1);
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_bucket_contains(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 fingerprint) {
+    // xor makes the matching slot zero, then the usual test for a zero byte or u16 in a word
+    if (filter->fingerprint_size == 1) {
+        u32 slots = ((u32*)filter->buckets)[bucket] ^ (fingerprint * 0x01010101u);
+
+        return ((slots - 0x01010101u) & ~slots & 0x80808080u) != 0;
+    }
+
+    u64 slots = ((u64*)filter->buckets)[bucket] ^ (fingerprint * 0x0001000100010001ull);
+
+    return ((slots - 0x0001000100010001ull) & ~slots & 0x8000800080008000ull) != 0;
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+u32
+cuckoo_filter_get(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 slot) {
+    if (filter->fingerprint_size == 1) {
+        return filter->buckets[(u64)bucket * CUCKOO_FILTER_SLOTS + slot];
+    }
+
+    return ((u16*)filter->buckets)[(u64)bucket * CUCKOO_FILTER_SLOTS + slot];
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+void
+cuckoo_filter_set(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 slot, u32 fingerprint) {
+    if (filter->fingerprint_size == 1) {
+        filter->buckets[(u64)bucket * CUCKOO_FILTER_SLOTS + slot] = (u8)fingerprint;
+    } else {
+        ((u16*)filter->buckets)[(u64)bucket * CUCKOO_FILTER_SLOTS + slot] = (u16)fingerprint;
+    }
+}
+
+template <typename Key, typename Alloc, typename Hash>
+static inline
+bool
+cuckoo_filter_put(Cuckoo_Filter<Key, Alloc, Hash>* filter, u32 bucket, u32 fingerprint) {
+    for (u32 slot = 0; slot < CUCKOO_FILTER_SLOTS; slot++) {
+        if (cuckoo_filter_get(filter, bucket, slot) == 0) {
+            cuckoo_filter_set(filter, bucket, slot, fingerprint);
+            return true;
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
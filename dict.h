@@ -0,0 +1,488 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <memory.h>
+#include "hash_functions.h"
+
+#define DICT_INITIAL_CAPACITY 16
+#define DICT_GROWTH_FACTOR    2
+#define DICT_MAX_LOAD_FACTOR  70 // of the index
+
+// Hash of removed entries. Real hashes equal to it are changed to DICT_HOLE - 1.
+#define DICT_HOLE 0xFFFFFFFFFFFFFFFFull
+
+// Index slots, widened to u32. Narrow indices store the lowest bytes of them.
+#define DICT_INDEX_EMPTY   0xFFFFFFFF
+#define DICT_INDEX_DELETED 0xFFFFFFFE
+
+#define DICT_NOT_FOUND 0xFFFFFFFF
+
+/*
+    Dict keeps entries densely in insertion order, the hash index only stores positions of the entries.
+    Index slots are u8 for up to 254 entries, u16 up to 65534, u32 above, so a small dict has a tiny index.
+    Iteration walks the entries array and skips removed entries (holes), they are dropped when the entries
+    array is full and reallocated. Hash and Equal are the same policies as in Hash_Table.
+*/
+template <typename Key, typename Value>
+struct Dict_Entry {
+    u64   hash;
+    Key   key;
+    Value value;
+};
+
+template <typename Key, typename Value>
+struct Dict_Iterator {
+    Dict_Entry<Key, Value>* entry;
+    Dict_Entry<Key, Value>* end;
+
+    Dict_Iterator(Dict_Entry<Key, Value>* entry, Dict_Entry<Key, Value>* end) : entry(entry), end(end) {
+        skip_holes();
+    }
+
+    Dict_Entry<Key, Value>& operator*()  const { return *entry; }
+    Dict_Entry<Key, Value>* operator->() const { return entry; }
+
+    Dict_Iterator& operator++() {
+        entry++;
+        skip_holes();
+        return *this;
+    }
+
+    bool operator==(const Dict_Iterator& other) const { return entry == other.entry; }
+    bool operator!=(const Dict_Iterator& other) const { return entry != other.entry; }
+
+    void skip_holes() {
+        while (entry != end && entry->hash == DICT_HOLE) entry++;
+    }
+};
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+struct Dict {
+    Dict_Entry<Key, Value>* entries;
+    u8*                     index;
+    u32                     count;      // entries without holes
+    u32                     used;       // entries with holes
+    u32                     capacity;   // of entries
+    u32                     slots;      // of index, power of 2
+    u32                     index_size; // 1, 2 or 4 bytes
+    Allocator*              allocator;
+
+    Dict_Iterator<Key, Value> begin() { return Dict_Iterator<Key, Value>(entries, &entries[used]); }
+    Dict_Iterator<Key, Value> end()   { return Dict_Iterator<Key, Value>(&entries[used], &entries[used]); }
+
+    Dict(u32 capacity = DICT_INITIAL_CAPACITY, Allocator* allocator = Alloc::get_default());
+
+    ~Dict() {
+        Alloc::free(allocator, index);
+    }
+};
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+static inline
+Dict<Key, Value, Alloc, Hash, Equal>*
+dict_make(u32 capacity = DICT_INITIAL_CAPACITY, Allocator* allocator = Alloc::get_default());
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_free(Dict<Key, Value, Alloc, Hash, Equal>* dict);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_reserve(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 count); // Makes room for count entries, so adding them doesn't reallocate.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_add(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value value);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_set(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value value);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_add_or_set(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value value); // Returns true if the key was already there. Set keeps the position of the entry.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_remove(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_remove_if_contains(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key); // Returns true if the key was removed.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_contains(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value
+dict_get(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_try_get(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value* value);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+dict_get_ptr(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key); // Returns pointer to the value or null. The pointer is valid until the next add.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+dict_find_or_insert(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, bool* inserted = null); // Returns pointer to the value of the key, new value is zero initialized and goes to the end.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_allocate(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 capacity); // Allocates empty entries and index, old ones are not freed.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_realloc(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 capacity); // Moves entries without holes into new arrays and rebuilds the index.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+dict_find(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, u64 hash, u32* slot); // Returns entry of the key or DICT_NOT_FOUND. slot is the index slot of the key or the slot to put it into.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+dict_index_get(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 slot);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_index_set(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 slot, u32 entry);
+
+static inline
+u64
+dict_hash(u64 hash); // Keeps DICT_HOLE for holes only.
+
+// Implementation
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+Dict<Key, Value, Alloc, Hash, Equal>::Dict(u32 capacity, Allocator* allocator) : allocator(allocator) {
+    dict_allocate(this, capacity);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Dict<Key, Value, Alloc, Hash, Equal>*
+dict_make(u32 capacity, Allocator* allocator) {
+    ALLOCATOR_TAG("dict_make");
+    auto dict = (Dict<Key, Value, Alloc, Hash, Equal>*)Alloc::alloc(allocator, sizeof(Dict<Key, Value, Alloc, Hash, Equal>), alignof(Dict<Key, Value, Alloc, Hash, Equal>));
+    Assert(dict, "Cannot allocate memory for dict.");
+
+    dict->allocator = allocator;
+
+    dict_allocate(dict, capacity);
+
+    return dict;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_free(Dict<Key, Value, Alloc, Hash, Equal>* dict) {
+    Alloc::free(dict->allocator, dict->index);
+    Alloc::free(dict->allocator, dict);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_reserve(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 count) {
+    if (count > dict->capacity - dict->used + dict->count) {
+        ALLOCATOR_TAG("dict_realloc");
+        dict_realloc(dict, count);
+    }
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_add(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value value) {
+    bool inserted;
+    Value* ptr = dict_find_or_insert(dict, key, &inserted);
+    Assert(inserted, "An item with the same key has already been added.");
+
+    *ptr = value;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_set(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value value) {
+    Value* ptr = dict_get_ptr(dict, key);
+    Assert(ptr, "The key is not presented in the dict.");
+
+    *ptr = value;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_add_or_set(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value value) {
+    bool inserted;
+
+    *dict_find_or_insert(dict, key, &inserted) = value;
+
+    return !inserted;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_remove(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key) {
+    if (!dict_remove_if_contains(dict, key)) {
+        Assert(false, "The key was not presented in the dict.");
+    }
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_remove_if_contains(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key) {
+    u32 slot;
+    u32 entry = dict_find(dict, key, dict_hash(Hash::hash(key)), &slot);
+
+    if (entry == DICT_NOT_FOUND) {
+        return false;
+    }
+
+    dict_index_set(dict, slot, DICT_INDEX_DELETED);
+    dict->entries[entry].hash = DICT_HOLE;
+    dict->count--;
+
+    return true;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_contains(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key) {
+    u32 slot;
+
+    return dict_find(dict, key, dict_hash(Hash::hash(key)), &slot) != DICT_NOT_FOUND;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value
+dict_get(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key) {
+    Value* ptr = dict_get_ptr(dict, key);
+    Assert(ptr, "The key was not presented in the dict.");
+
+    return *ptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+dict_try_get(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, Value* value) {
+    Value* ptr = dict_get_ptr(dict, key);
+
+    if (!ptr) {
+        return false;
+    }
+
+    *value = *ptr;
+
+    return true;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+dict_get_ptr(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key) {
+    u32 slot;
+    u32 entry = dict_find(dict, key, dict_hash(Hash::hash(key)), &slot);
+
+    if (entry == DICT_NOT_FOUND) {
+        return null;
+    }
+
+    return &dict->entries[entry].value;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+dict_find_or_insert(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, bool* inserted) {
+    u64 hash = dict_hash(Hash::hash(key));
+    u32 slot;
+    u32 entry = dict_find(dict, key, hash, &slot);
+
+    if (entry != DICT_NOT_FOUND) {
+        if (inserted) *inserted = false;
+        return &dict->entries[entry].value;
+    }
+
+    if (dict->used == dict->capacity) {
+        ALLOCATOR_TAG("dict_realloc");
+
+        // if the entries are mostly holes, the same capacity is enough
+        u32 capacity = dict->count * DICT_GROWTH_FACTOR;
+        if (capacity < DICT_INITIAL_CAPACITY) capacity = DICT_INITIAL_CAPACITY;
+
+        dict_realloc(dict, capacity);
+        dict_find(dict, key, hash, &slot);
+    }
+
+    entry = dict->used++;
+    dict->count++;
+
+    dict->entries[entry].hash  = hash;
+    dict->entries[entry].key   = key;
+    dict->entries[entry].value = Value();
+    dict_index_set(dict, slot, entry);
+
+    if (inserted) *inserted = true;
+
+    return &dict->entries[entry].value;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_allocate(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 capacity) {
+    if (capacity == 0) capacity = 1;
+
+    u32 slots = 8;
+    while ((u64)slots * DICT_MAX_LOAD_FACTOR < (u64)capacity * 100) slots *= 2;
+
+    u32 index_size = capacity <= 0xFE ? 1 : capacity <= 0xFFFE ? 2 : 4;
+
+    // index first, entries after it, aligned
+    u64 alignment = alignof(Dict_Entry<Key, Value>);
+    u64 entries   = ((u64)slots * index_size + alignment - 1) & ~(alignment - 1);
+
+    u8* data = (u8*)Alloc::alloc(dict->allocator, entries + sizeof(Dict_Entry<Key, Value>) * capacity, alignment);
+    Assert(data, "Cannot allocate memory for dict data.");
+
+    // DICT_INDEX_EMPTY in any width
+    memset(data, 0xFF, (u64)slots * index_size);
+
+    dict->index      = data;
+    dict->entries    = (Dict_Entry<Key, Value>*)(data + entries);
+    dict->count      = 0;
+    dict->used       = 0;
+    dict->capacity   = capacity;
+    dict->slots      = slots;
+    dict->index_size = index_size;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_realloc(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 capacity) {
+    Assert(capacity >= dict->count, "Cannot fit dict entries into less capacity.");
+
+    u8*                     index   = dict->index;
+    Dict_Entry<Key, Value>* entries = dict->entries;
+    u32                     used    = dict->used;
+
+    dict_allocate(dict, capacity);
+
+    for (u32 i = 0; i < used; i++) {
+        if (entries[i].hash == DICT_HOLE) continue;
+
+        u32 entry = dict->used++;
+        u32 slot  = (u32)entries[i].hash & (dict->slots - 1);
+
+        // keys are unique, the first empty slot is the place
+        while (dict_index_get(dict, slot) != DICT_INDEX_EMPTY) {
+            slot = (slot + 1) & (dict->slots - 1);
+        }
+
+        dict->entries[entry] = entries[i];
+        dict_index_set(dict, slot, entry);
+    }
+
+    dict->count = dict->used;
+
+    Alloc::free(dict->allocator, index);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+dict_find(Dict<Key, Value, Alloc, Hash, Equal>* dict, Key key, u64 hash, u32* slot) {
+    u32 mask = dict->slots - 1;
+    u32 free = DICT_NOT_FOUND;
+
+    // index never gets full, holes and deleted slots are dropped before it does
+    for (u32 i = (u32)hash & mask; ; i = (i + 1) & mask) {
+        u32 entry = dict_index_get(dict, i);
+
+        if (entry == DICT_INDEX_EMPTY) {
+            *slot = free == DICT_NOT_FOUND ? i : free;
+            return DICT_NOT_FOUND;
+        }
+
+        if (entry == DICT_INDEX_DELETED) {
+            if (free == DICT_NOT_FOUND) free = i;
+            continue;
+        }
+
+        if (dict->entries[entry].hash == hash && Equal::equal(dict->entries[entry].key, key)) {
+            *slot = i;
+            return entry;
+        }
+    }
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+dict_index_get(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 slot) {
+    u32 entry;
+
+    switch (dict->index_size) {
+        case 1:
+            entry = dict->index[slot];
+            return entry >= 0xFE ? entry | 0xFFFFFF00 : entry;
+        case 2:
+            entry = ((u16*)dict->index)[slot];
+            return entry >= 0xFFFE ? entry | 0xFFFF0000 : entry;
+        default:
+            return ((u32*)dict->index)[slot];
+    }
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+dict_index_set(Dict<Key, Value, Alloc, Hash, Equal>* dict, u32 slot, u32 entry) {
+    switch (dict->index_size) {
+        case 1:
+            dict->index[slot] = (u8)entry;
+            break;
+        case 2:
+            ((u16*)dict->index)[slot] = (u16)entry;
+            break;
+        default:
+            ((u32*)dict->index)[slot] = entry;
+            break;
+    }
+}
+
+static inline
+u64
+dict_hash(u64 hash) {
+    return hash == DICT_HOLE ? DICT_HOLE - 1 : hash;
+}
\ No newline at end of file
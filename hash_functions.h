@@ -1,49 +1,250 @@
 #pragma once
 
+#include <memory.h>
+
+/*
+    Hashes of ints go through murmur3 fmix64, so sequential ids spread over all 64 bits.
+    Bytes and strings are hashed with wyhash (final version 4), reading 8 bytes at a time.
+    Everything is constexpr, so keys can be hashed at compile time. Byte buffers are read through
+    memcpy at runtime and byte by byte in constant evaluation.
+*/
+#define HASH_SECRET_0 0x2d358dccaa6c78a5ull
+#define HASH_SECRET_1 0x8bb84b93962eacc9ull
+#define HASH_SECRET_2 0x4b33a62ed433d4a3ull
+#define HASH_SECRET_3 0x4d5a2da51de1aa47ull
+
+static inline constexpr
+u64
+hash_u64(u64 x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+
+    return x;
+}
+
+static inline constexpr
+u64
+hash_mix(u64 a, u64 b) {
+    __uint128_t r = (__uint128_t)a * b;
+
+    return (u64)r ^ (u64)(r >> 64);
+}
+
+template <typename Char>
+static inline constexpr
+u64
+hash_read(const Char* p, u32 bytes) {
+    if (!__builtin_is_constant_evaluated()) {
+        u64 value = 0;
+        memcpy(&value, p, bytes);
+        return value;
+    }
+
+    u64 value = 0;
+
+    for (u32 i = 0; i < bytes; i++) {
+        value |= (u64)(u8)p[i] << (i * 8);
+    }
+
+    return value;
+}
+
+// Char is u8 or char, other types are read through hash_bytes.
+template <typename Char>
+static inline constexpr
+u64
+hash_chars(const Char* p, u64 length, u64 seed = 0) {
+    u64 a;
+    u64 b;
+
+    seed ^= hash_mix(seed ^ HASH_SECRET_0, HASH_SECRET_1);
+
+    if (length <= 16) {
+        if (length >= 4) {
+            u64 step = (length >> 3) << 2;
+            a = (hash_read(p, 4) << 32) | hash_read(p + step, 4);
+            b = (hash_read(p + length - 4, 4) << 32) | hash_read(p + length - 4 - step, 4);
+        } else if (length > 0) {
+            a = ((u64)(u8)p[0] << 16) | ((u64)(u8)p[length >> 1] << 8) | (u64)(u8)p[length - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        u64 i = length;
+
+        if (i >= 48) {
+            u64 seed1 = seed;
+            u64 seed2 = seed;
+
+            // 3 independent lanes, so the multiplications overlap
+            do {
+                seed  = hash_mix(hash_read(p, 8) ^ HASH_SECRET_1, hash_read(p + 8, 8) ^ seed);
+                seed1 = hash_mix(hash_read(p + 16, 8) ^ HASH_SECRET_2, hash_read(p + 24, 8) ^ seed1);
+                seed2 = hash_mix(hash_read(p + 32, 8) ^ HASH_SECRET_3, hash_read(p + 40, 8) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+
+            seed ^= seed1 ^ seed2;
+        }
+
+        while (i > 16) {
+            seed = hash_mix(hash_read(p, 8) ^ HASH_SECRET_1, hash_read(p + 8, 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        a = hash_read(p + i - 16, 8);
+        b = hash_read(p + i - 8, 8);
+    }
+
+    a ^= HASH_SECRET_1;
+    b ^= seed;
+
+    __uint128_t r = (__uint128_t)a * b;
+    a = (u64)r;
+    b = (u64)(r >> 64);
+
+    return hash_mix(a ^ HASH_SECRET_0 ^ length, b ^ HASH_SECRET_1);
+}
+
 static inline
-u32
+u64
+hash_bytes(const void* data, u64 length, u64 seed = 0) {
+    return hash_chars((const u8*)data, length, seed);
+}
+
+static inline constexpr
+u64
+hash_string(const char* string, u64 length, u64 seed = 0) {
+    return hash_chars(string, length, seed);
+}
+
+static inline constexpr
+u64
+hash_string(const char* string) {
+    u64 length = 0;
+
+    while (string[length]) length++;
+
+    return hash_chars(string, length, 0);
+}
+
+static inline constexpr
+u64
 get_hash(u8 i) {
-    return 1 + i ^ 33;
+    return hash_u64(i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(s8 i) {
-    return 1 + i ^ 33;
+    return hash_u64((u8)i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(u16 i) {
-    return 1 + i ^ 234656;
+    return hash_u64(i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(s16 i) {
-    return 1 + i ^ 982374;
+    return hash_u64((u16)i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(u32 i) {
-    return 1 + i ^ 109238123;
+    return hash_u64(i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(s32 i) {
-    return 1 + i ^ 98672453;
+    return hash_u64((u32)i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(u64 i) {
-    return 1 + i ^ 17862943124;
+    return hash_u64(i);
 }
 
-static inline
-u32
+static inline constexpr
+u64
 get_hash(s64 i) {
-    return 1 + i ^ 9875612353;
-}
\ No newline at end of file
+    return hash_u64((u64)i);
+}
+
+/*
+    Hash and equality policies of hash tables. They are stateless, the table calls Hash::hash(key)
+    and Equal::equal(a, b), so they are inlined into the probe loop.
+*/
+struct Default_Hash {
+    template <typename Key>
+    static inline constexpr
+    u64
+    hash(const Key& key) {
+        return get_hash(key);
+    }
+};
+
+// For keys that are already good hashes.
+struct Identity_Hash {
+    template <typename Key>
+    static inline constexpr
+    u64
+    hash(const Key& key) {
+        return (u64)key;
+    }
+};
+
+// Hashes bytes of the key with the seed, so tables can use different hashes for the same key type. Key must have no padding.
+template <u64 Seed>
+struct Seeded_Hash {
+    template <typename Key>
+    static inline
+    u64
+    hash(const Key& key) {
+        return hash_bytes(&key, sizeof(Key), Seed);
+    }
+};
+
+struct String_Hash {
+    static inline constexpr
+    u64
+    hash(const char* key) {
+        return hash_string(key);
+    }
+};
+
+struct Default_Equal {
+    template <typename Key>
+    static inline constexpr
+    bool
+    equal(const Key& a, const Key& b) {
+        return a == b;
+    }
+};
+
+struct String_Equal {
+    static inline constexpr
+    bool
+    equal(const char* a, const char* b) {
+        if (a == b) return true;
+
+        while (*a && *a == *b) {
+            a++;
+            b++;
+        }
+
+        return *a == *b;
+    }
+};
\ No newline at end of file
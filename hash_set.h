@@ -0,0 +1,325 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <memory.h>
+#include "hash_functions.h"
+#include "hash_table.h"
+
+/*
+    Hash_Set is Hash_Table without values: control bytes and keys, nothing else, so a set of u64
+    takes 9 bytes per slot. Probing, growth and deletion are the same as in Hash_Table.
+    Union, intersection and difference change the first set in place.
+*/
+template <typename Key, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+struct Hash_Set {
+    u8*        control;
+    Key*       keys;
+    u32        count;
+    u32        deleted;
+    u32        length;
+    u32        alignment;
+    Allocator* allocator;
+
+    Hash_Set(u32 length = HASH_TABLE_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default(), u32 alignment = alignof(Key));
+
+    ~Hash_Set() {
+        Alloc::free(allocator, control);
+    }
+};
+
+template <typename Key, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+static inline
+Hash_Set<Key, Alloc, Hash, Equal>*
+hash_set_make(u32 length = HASH_TABLE_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default(), u32 alignment = alignof(Key));
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_free(Hash_Set<Key, Alloc, Hash, Equal>* hash_set);
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_reserve(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 count); // Makes room for count keys, so adding them doesn't rehash.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_add(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Key key); // Returns true if the key was added, false if it's already in the set or the set is full and cannot grow.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_contains(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Key key);
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_remove(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Key key); // Returns true if the key was removed.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_union(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Hash_Set<Key, Alloc, Hash, Equal>* other); // Adds keys of other.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_intersection(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Hash_Set<Key, Alloc, Hash, Equal>* other); // Removes keys that are not in other.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_difference(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Hash_Set<Key, Alloc, Hash, Equal>* other); // Removes keys that are in other.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_allocate(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 length); // Allocates empty arrays for length slots, old arrays are not freed.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_rehash(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 length);
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_grow_if_full(Hash_Set<Key, Alloc, Hash, Equal>* hash_set); // Called before adding a new key. Returns false if there is no room and the length is HASH_TABLE_MAX_LENGTH.
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_erase_at(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 index);
+
+// Implementation
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+Hash_Set<Key, Alloc, Hash, Equal>::Hash_Set(u32 length, Allocator* allocator, u32 alignment) : count(0),
+                                                                                              alignment(alignment),
+                                                                                              allocator(allocator) {
+    hash_set_allocate(this, length);
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+Hash_Set<Key, Alloc, Hash, Equal>*
+hash_set_make(u32 length, Allocator* allocator, u32 alignment) {
+    ALLOCATOR_TAG("hash_set_make");
+    auto hash_set = (Hash_Set<Key, Alloc, Hash, Equal>*)Alloc::alloc(allocator, sizeof(Hash_Set<Key, Alloc, Hash, Equal>), alignof(Hash_Set<Key, Alloc, Hash, Equal>));
+    Assert(hash_set, "Cannot allocate memory for hash_set.");
+
+    hash_set->count     = 0;
+    hash_set->alignment = alignment;
+    hash_set->allocator = allocator;
+
+    hash_set_allocate(hash_set, length);
+
+    return hash_set;
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_free(Hash_Set<Key, Alloc, Hash, Equal>* hash_set) {
+    Alloc::free(hash_set->allocator, hash_set->control);
+    Alloc::free(hash_set->allocator, hash_set);
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_reserve(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 count) {
+    u32 length = hash_table_length_for(count);
+
+    if (length > hash_set->length) {
+        ALLOCATOR_TAG("hash_set_realloc");
+        hash_set_rehash(hash_set, length);
+    }
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_add(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Key key) {
+    u64 hash = Hash::hash(key);
+    u32 free;
+
+    if (hash_table_probe_or_free<Key, Equal>(hash_set->control, hash_set->keys, hash_set->length, key, hash, &free) != HASH_TABLE_NOT_FOUND) {
+        return false;
+    }
+
+    u8* control = hash_set->control;
+
+    if (!hash_set_grow_if_full(hash_set)) {
+        Assert(false, "Hash set is full.");
+        return false;
+    }
+
+    // rehashed, the free slot has moved
+    if (control != hash_set->control) {
+        free = hash_table_probe_free(hash_set->control, hash_set->length, hash);
+    }
+
+    if (hash_set->control[free] == HASH_TABLE_DELETED) hash_set->deleted--;
+
+    hash_set->control[free] = hash & 0x7F;
+    hash_set->keys[free]    = key;
+    hash_set->count++;
+
+    return true;
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_contains(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Key key) {
+    return hash_table_probe<Key, Equal>(hash_set->control, hash_set->keys, hash_set->length, key, Hash::hash(key)) != HASH_TABLE_NOT_FOUND;
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_remove(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Key key) {
+    u32 index = hash_table_probe<Key, Equal>(hash_set->control, hash_set->keys, hash_set->length, key, Hash::hash(key));
+
+    if (index == HASH_TABLE_NOT_FOUND) {
+        return false;
+    }
+
+    hash_set_erase_at(hash_set, index);
+
+    return true;
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_union(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Hash_Set<Key, Alloc, Hash, Equal>* other) {
+    for (u32 i = 0; i < other->length; i++) {
+        if (other->control[i] & HASH_TABLE_EMPTY) continue;
+
+        hash_set_add(hash_set, other->keys[i]);
+    }
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_intersection(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Hash_Set<Key, Alloc, Hash, Equal>* other) {
+    // erasing never moves other keys, so it's fine to erase while iterating
+    for (u32 i = 0; i < hash_set->length; i++) {
+        if (hash_set->control[i] & HASH_TABLE_EMPTY) continue;
+
+        if (!hash_set_contains(other, hash_set->keys[i])) {
+            hash_set_erase_at(hash_set, i);
+        }
+    }
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_difference(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, Hash_Set<Key, Alloc, Hash, Equal>* other) {
+    // iterate the smaller one
+    if (other->count < hash_set->count) {
+        for (u32 i = 0; i < other->length; i++) {
+            if (other->control[i] & HASH_TABLE_EMPTY) continue;
+
+            hash_set_remove(hash_set, other->keys[i]);
+        }
+    } else {
+        for (u32 i = 0; i < hash_set->length; i++) {
+            if (hash_set->control[i] & HASH_TABLE_EMPTY) continue;
+
+            if (hash_set_contains(other, hash_set->keys[i])) {
+                hash_set_erase_at(hash_set, i);
+            }
+        }
+    }
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_allocate(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 length) {
+    // at least one group, power of 2
+    if (length < HASH_TABLE_GROUP_WIDTH) length = HASH_TABLE_GROUP_WIDTH;
+    Assert(length <= 0x80000000, "Hash set length is too big.");
+    length = 1u << (32 - __builtin_clz(length - 1));
+
+    u64 alignment = hash_set->alignment < alignof(Key) ? alignof(Key) : hash_set->alignment;
+    u64 keys      = ((u64)length + alignment - 1) & ~(alignment - 1);
+
+    u8* data = (u8*)Alloc::alloc(hash_set->allocator, keys + sizeof(Key) * length, alignment);
+    Assert(data, "Cannot allocate memory for hash_set data.");
+
+    memset(data, HASH_TABLE_EMPTY, length);
+
+    hash_set->control = data;
+    hash_set->keys    = (Key*)(data + keys);
+    hash_set->deleted = 0;
+    hash_set->length  = length;
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_rehash(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 length) {
+    u8*  control    = hash_set->control;
+    Key* keys       = hash_set->keys;
+    u32  old_length = hash_set->length;
+
+    hash_set_allocate(hash_set, length);
+
+    for (u32 i = 0; i < old_length; i++) {
+        if (control[i] & HASH_TABLE_EMPTY) continue;
+
+        u32 index = hash_table_probe_free(hash_set->control, hash_set->length, Hash::hash(keys[i]));
+
+        hash_set->control[index] = control[i];
+        hash_set->keys[index]    = keys[i];
+    }
+
+    Alloc::free(hash_set->allocator, control);
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_set_grow_if_full(Hash_Set<Key, Alloc, Hash, Equal>* hash_set) {
+    u64 limit = (u64)hash_set->length * HASH_TABLE_MAX_LOAD_FACTOR;
+
+    if ((u64)(hash_set->count + hash_set->deleted + 1) * 100 <= limit) return true;
+
+    u32 length = hash_set->length;
+
+    if ((u64)(hash_set->count + 1) * 100 > (u64)length * HASH_TABLE_MIN_LOAD_FACTOR) {
+        // length is u32, it would wrap to 0
+        if (length > HASH_TABLE_MAX_LENGTH / HASH_TABLE_GROWTH_FACTOR) return false;
+
+        length *= HASH_TABLE_GROWTH_FACTOR;
+    }
+
+    ALLOCATOR_TAG("hash_set_realloc");
+    hash_set_rehash(hash_set, length);
+
+    return true;
+}
+
+template <typename Key, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_set_erase_at(Hash_Set<Key, Alloc, Hash, Equal>* hash_set, u32 index) {
+    u32 start = index & ~(HASH_TABLE_GROUP_WIDTH - 1);
+
+    if (hash_table_group_match_empty(&hash_set->control[start])) {
+        hash_set->control[index] = HASH_TABLE_EMPTY;
+    } else {
+        hash_set->control[index] = HASH_TABLE_DELETED;
+        hash_set->deleted++;
+    }
+
+    hash_set->count--;
+}
\ No newline at end of file
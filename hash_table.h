@@ -6,361 +6,1116 @@
 #include <memory.h>
 #include "hash_functions.h"
 
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// The same in every build, the group count and probe sequences depend on it, and a table may be shared
+// between translation units compiled with different flags.
+#define HASH_TABLE_GROUP_WIDTH 16
+
 #define HASH_TABLE_INITIAL_LENGTH  256
-#define HASH_TABLE_REALLOC_STEP    128
+#define HASH_TABLE_GROWTH_FACTOR   2
 #define HASH_TABLE_MAX_LOAD_FACTOR 70
+#define HASH_TABLE_MIN_LOAD_FACTOR 35 // If a full table has less elements than that, it's full of deleted slots and rehashed at the same length.
+#define HASH_TABLE_MAX_LENGTH      0x80000000u // The biggest power of 2 in u32. A full table of this length doesn't take new keys.
 
-template <typename Value>
-struct Hash_Table_Slot {
-    Value value;
-    u32   hash;
-    bool  tombstone;
-};
+// Control bytes. A full slot keeps the lowest 7 bits of its hash in the control byte, so the highest bit is 0.
+#define HASH_TABLE_EMPTY   0x80
+#define HASH_TABLE_DELETED 0xFE
+
+#define HASH_TABLE_NOT_FOUND 0xFFFFFFFF
+
+// Flags
+#define HASH_TABLE_INCREMENTAL 0x1 // Resize moves HASH_TABLE_MIGRATE_GROUPS groups per add or remove, instead of the whole table at once.
+
+#define HASH_TABLE_MIGRATE_GROUPS 2
+#define HASH_TABLE_PREPARE_LOAD_FACTOR 60 // With HASH_TABLE_INCREMENTAL the arrays of the next resize are allocated past this load and cleared a part per add.
+
+// Batch functions hash that many keys and prefetch their control bytes, then prefetch keys of the matched slots, then probe.
+#define HASH_TABLE_BATCH_SIZE 16
 
 /*
-    Fuck you, c++. I wanted to make hash function as a template parameter, but it looks ugly,
-    unreadable and need 2 lines to write fucking template<bullshit>
-    So now it's a function, you need to define somewhere in code before including this file.
-    The name of the function should be exactly "get_hash" and the signature:
-    u32 get_hash(T key);
-    Oversimplified hash functions for int types are already defined in "hash_functions.h".
+    Hash and Equal are policies with static hash(key) and equal(a, b), see "hash_functions.h".
+    By default the table calls get_hash(key) and compares keys with ==. get_hash of int types is already defined,
+    for your own types define u64 get_hash(T key) next to the type, or pass a policy: Identity_Hash for keys that
+    are hashes already, Seeded_Hash<seed> for a salted hash, String_Hash and String_Equal for c strings.
+    The table takes the group from the high bits of the hash and the control byte from the lowest 7 bits, so all bits should be mixed.
+
+    Slots are split into groups of HASH_TABLE_GROUP_WIDTH. Every slot has a control byte, a key and a value,
+    each in its own array. Lookup compares 7 bits of the hash with a whole group of control bytes at once
+    (SSE2) and compares keys only for the slots that matched. Values are touched only when found.
+    All arrays live in one allocation, aligned to alignment. Pass CACHE_LINE_SIZE for hot tables.
+    Length is always a power of 2, so the group index is a mask and the triangular probe sequence visits every group.
+    Removed slot becomes empty again if its group has an empty slot, because no probe sequence went past such group.
+    Otherwise it's marked deleted. Deleted slots count towards the load factor and are dropped by the next rehash.
+
+    With HASH_TABLE_INCREMENTAL the old arrays are kept after resize and migrated a few groups at a time by adds and removes.
+    Until they are gone lookups check the new arrays first, then the old ones. reserve, realloc and add_many finish the migration.
+    get_ptr and find_or_insert move the key they find in the old arrays ahead of the migration, so they never return pointers into them.
+    The new arrays are allocated earlier, at HASH_TABLE_PREPARE_LOAD_FACTOR, and every add clears a part of their control bytes,
+    so no single add clears the whole array.
 */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
 struct Hash_Table {
-    Hash_Table_Slot<Value>* data;
-    u32                     count;
-    u32                     length;
-    Allocator*              allocator;
-
-    Hash_Table(u32 length = HASH_TABLE_INITIAL_LENGTH, Allocator* allocator = &Allocator_Std) :
-                                                                   count(0),
-                                                                   length(length),
-                                                                   allocator(allocator) {
-        data = (Hash_Table_Slot<Value>*)allocator_alloc(allocator, sizeof(Hash_Table_Slot<Value>) * length);
-        Assert(data, "Cannot allocate memory for hash_table data.");
-
-        memset(data, 0, sizeof(Hash_Table_Slot<Value>) * length);
-    }
+    u8*        control;
+    Key*       keys;
+    Value*     values;
+    u32        count;
+    u32        deleted;
+    u32        length;
+    u32        alignment;
+    u32        flags;
+    Allocator* allocator;
+
+    // arrays of incremental resize, null when no resize is in progress
+    u8*        old_control;
+    Key*       old_keys;
+    Value*     old_values;
+    u32        old_length;
+    u32        migrated; // groups of the old arrays that are already moved
+
+    // arrays of the next incremental resize, null until the load reaches HASH_TABLE_PREPARE_LOAD_FACTOR
+    u8*        next_data;
+    u32        next_length;
+    u32        next_cleared; // control bytes of the next arrays that are already empty
+    u32        next_step;    // control bytes cleared per add
+
+    Hash_Table(u32 length = HASH_TABLE_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default(), u32 alignment = alignof(Value), u32 flags = 0);
 
     ~Hash_Table() {
-        if (allocator == &Allocator_Temp) return;
-
-        allocator_free(allocator, data);
+        Alloc::free(allocator, next_data);
+        Alloc::free(allocator, old_control);
+        Alloc::free(allocator, control);
     }
 };
 
-template <typename Key, typename Value>
+// Where the arrays are inside of the table's allocation
+struct Hash_Table_Layout {
+    u64 size;
+    u64 alignment;
+    u64 keys;
+    u64 values;
+};
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
 static inline
-Hash_Table<Key, Value>*
-hash_table_make(u32 length = HASH_TABLE_INITIAL_LENGTH, Allocator* allocator = &Allocator_Std);
+Hash_Table<Key, Value, Alloc, Hash, Equal>*
+hash_table_make(u32 length = HASH_TABLE_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default(), u32 alignment = alignof(Value), u32 flags = 0);
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_realloc(Hash_Table<Key, Value>* hash_table, u32 length);
+hash_table_realloc(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length);
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_free(Hash_Table<Key, Value>* hash_table);
+hash_table_reserve(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 count); // Makes room for count elements, so adding them doesn't rehash.
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_add(Hash_Table<Key, Value>* hash_table, Key key, Value value);
+hash_table_free(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table);
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_set(Hash_Table<Key, Value>* hash_table, Key key, Value value);
+hash_table_finish_resize(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table); // Migrates what's left of the incremental resize.
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_add(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value value); // Doesn't add anything if the table is full and cannot grow.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_set(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value value);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 bool
-hash_table_add_or_set(Hash_Table<Key, Value>* hash_table, Key key, Value value); // Adds or sets element. If element with the same key already been added, returns true, otherwise return false.
+hash_table_add_or_set(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value value); // Adds or sets element. If element with the same key already been added, returns true, otherwise return false. Doesn't add anything if the table is full and cannot grow.
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_remove(Hash_Table<Key, Value>* hash_table, Key key);
+hash_table_remove(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key);
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 bool
-hash_table_remove_if_contains(Hash_Table<Key, Value>* hash_table, Key key); // Removes element from hash table if it exist. Returns true if element was removed, false if not.
+hash_table_remove_if_contains(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key); // Removes element from hash table if it exist. Returns true if element was removed, false if not.
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 bool
-hash_table_contains(Hash_Table<Key, Value>* hash_table, Key key);
+hash_table_contains(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key);
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 Value
-hash_table_get(Hash_Table<Key, Value>* hash_table, Key key);
+hash_table_get(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key);
 
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_table_try_get(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value* value); // Copies the value into value and returns true if the key is presented, otherwise returns false.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+hash_table_get_ptr(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key); // Returns pointer to the value or null. The pointer is valid until the next add or until the key is removed.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+hash_table_find_or_insert(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, bool* inserted = null); // Returns pointer to the value of the key, new value is zero initialized. Sets inserted if the key was added. Returns null if the table is full and cannot grow.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 u32
-hash_table_double_hash(u32 hash, u32 length, u32 iteration = 0);
+hash_table_get_many(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, const Key* keys, u32 count, Value* values, bool* found = null); // Gets values of count keys, values of missing keys are not written. Returns number of found keys.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_contains_many(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, const Key* keys, u32 count, bool* found); // Returns number of found keys.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_add_many(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, const Key* keys, const Value* values, u32 count); // Rehashes at most once, before the first key. Doesn't add anything if the keys don't fit into the biggest table.
 
-// Implementation
 template <typename Key, typename Value>
 static inline
-Hash_Table<Key, Value>*
-hash_table_make(u32 length, Allocator* allocator) {
-    auto hash_table = (Hash_Table<Key, Value>*)allocator_alloc(allocator, sizeof(Hash_Table<Key, Value>));
+Hash_Table_Layout
+hash_table_layout(u32 length, u32 alignment);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_allocate(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length); // Allocates empty arrays for length slots, old arrays are not freed.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_set_arrays(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u8* data, u32 length); // Points the table at the arrays in data, its control bytes must be empty.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_rehash(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length); // Moves elements into new arrays of length slots, drops deleted slots.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_start_resize(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length); // Keeps current arrays as old and takes the prepared ones, see HASH_TABLE_INCREMENTAL.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_prepare_resize(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table); // Called by adds that fit. Allocates the arrays of the next resize past HASH_TABLE_PREPARE_LOAD_FACTOR and clears next_step of their control bytes.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_migrate(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 groups); // Moves elements of that many old groups into the new arrays, frees old arrays after the last one.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+hash_table_lookup(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, u64 hash); // Returns pointer to the value in the new or in the old arrays or null.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_take_old(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 index, u64 hash); // Moves the element at index of the old arrays into the new ones ahead of the migration, returns its new index.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_table_grow_if_full(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table); // Called before adding a new element. Returns false if there is no room and the length is HASH_TABLE_MAX_LENGTH.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_next_length(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table); // Length after the next resize, 0 if the table cannot grow.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_insert_at(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 index, u64 hash, Key key, Value value);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_erase_at(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 index);
+
+static inline
+u32
+hash_table_length_for(u32 count); // The smallest power of 2 length, that keeps count elements under the max load factor, at most HASH_TABLE_MAX_LENGTH.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_find(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, u64 hash); // Returns index of the slot with the key or HASH_TABLE_NOT_FOUND.
+
+template <typename Key, typename Equal>
+static inline
+u32
+hash_table_probe(const u8* control, const Key* keys, u32 length, Key key, u64 hash); // hash_table_find over any arrays.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_find_free(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u64 hash); // Returns index of the first empty or deleted slot in the probe sequence of the hash.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_prefetch(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u64 hash); // Prefetches control bytes of the first group of the hash.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_first_match(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u64 hash); // Index of the first slot of the first group, that matches control byte of the hash or HASH_TABLE_NOT_FOUND.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_find_or_free(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, u64 hash, u32* free); // Like hash_table_find, if the key is not found, stores index of the first free slot of the probe sequence.
+
+template <typename Key, typename Equal>
+static inline
+u32
+hash_table_probe_or_free(const u8* control, const Key* keys, u32 length, Key key, u64 hash, u32* free); // hash_table_find_or_free over any arrays.
+
+static inline
+u32
+hash_table_probe_free(const u8* control, u32 length, u64 hash); // hash_table_find_free over any control bytes.
+
+static inline
+u32
+hash_table_group_match(const u8* group, u8 control); // Bit i is set if control byte i of the group equals control.
+
+static inline
+u32
+hash_table_group_match_empty(const u8* group);
+
+static inline
+u32
+hash_table_group_match_free(const u8* group); // Empty or deleted slots.
+
+// Implementation
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+Hash_Table<Key, Value, Alloc, Hash, Equal>::Hash_Table(u32 length, Allocator* allocator, u32 alignment, u32 flags) : count(0),
+                                                                                                                    alignment(alignment),
+                                                                                                                    flags(flags),
+                                                                                                                    allocator(allocator),
+                                                                                                                    old_control(null),
+                                                                                                                    next_data(null) {
+    hash_table_allocate(this, length);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Hash_Table<Key, Value, Alloc, Hash, Equal>*
+hash_table_make(u32 length, Allocator* allocator, u32 alignment, u32 flags) {
+    ALLOCATOR_TAG("hash_table_make");
+    auto hash_table = (Hash_Table<Key, Value, Alloc, Hash, Equal>*)Alloc::alloc(allocator, sizeof(Hash_Table<Key, Value, Alloc, Hash, Equal>), alignof(Hash_Table<Key, Value, Alloc, Hash, Equal>));
     Assert(hash_table, "Cannot allocate memory for hash_table.");
-    auto data = (Hash_Table_Slot<Value>*)allocator_alloc(allocator, sizeof(Hash_Table_Slot<Value>) * length);
-    Assert(data, "Cannot allocate memory for hash_table data.");
 
-    memset(data, 0, sizeof(Hash_Table_Slot<Value>) * length);
+    hash_table->count       = 0;
+    hash_table->alignment   = alignment;
+    hash_table->flags       = flags;
+    hash_table->allocator   = allocator;
+    hash_table->old_control = null;
+    hash_table->next_data   = null;
 
-    hash_table->data      = data;
-    hash_table->count     = 0;
-    hash_table->length    = length;
-    hash_table->allocator = allocator;
+    hash_table_allocate(hash_table, length);
 
     return hash_table;
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_realloc(Hash_Table<Key, Value>* hash_table, u32 length) {
+hash_table_realloc(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length) {
+    ALLOCATOR_TAG("hash_table_realloc");
     Assert(length > hash_table->length, "Cannot resize hash table with less size.");
 
-    auto new_data = (Hash_Table_Slot<Value>*)allocator_alloc(hash_table->allocator, sizeof(Hash_Table_Slot<Value>) * length);
-    Assert(new_data, "Cannot allocate enough memory for new hash table data");
-
-    memset(new_data, 0, sizeof(Hash_Table_Slot<Value>) * length);
+    hash_table_rehash(hash_table, length);
+}
 
-    for (u32 i = 0; i < hash_table->length; i++) {
-        if (hash_table->data[i].hash != 0) {
-            u32 iteration = 0;
-            u32 index     = 0;
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_reserve(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 count) {
+    u32 length = hash_table_length_for(count);
 
-            while (true) {
-                index = hash_table_double_hash(hash_table->data[i].hash, length, iteration++);
+    if (length > hash_table->length) {
+        hash_table_realloc(hash_table, length);
+    }
+}
 
-                if (new_data[index].hash == 0) break;
-            }
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_free(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table) {
+    Alloc::free(hash_table->allocator, hash_table->next_data);
+    Alloc::free(hash_table->allocator, hash_table->old_control);
+    Alloc::free(hash_table->allocator, hash_table->control);
+    Alloc::free(hash_table->allocator, hash_table);
+}
 
-            new_data[index].hash      = hash_table->data[i].hash;
-            new_data[index].value     = hash_table->data[i].value;
-            new_data[index].tombstone = false;
-        }
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_finish_resize(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table) {
+    if (hash_table->old_control) {
+        hash_table_migrate(hash_table, hash_table->old_length / HASH_TABLE_GROUP_WIDTH);
     }
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_add(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value value) {
+    u64 hash = Hash::hash(key);
+    Assert(!hash_table_lookup(hash_table, key, hash), "An item with the same key has already been added.");
 
-    if (hash_table->allocator != &Allocator_Temp) {
-        allocator_free(hash_table->allocator, hash_table->data);
+    if (hash_table->old_control) hash_table_migrate(hash_table, HASH_TABLE_MIGRATE_GROUPS);
+
+    if (!hash_table_grow_if_full(hash_table)) {
+        Assert(false, "Hash table is full.");
+        return;
     }
 
-    hash_table->data   = new_data;
-    hash_table->length = length;
+    u32 index = hash_table_find_free(hash_table, hash);
+    hash_table_insert_at(hash_table, index, hash, key, value);
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_free(Hash_Table<Key, Value>* hash_table) {
-    // nothing to free if using Allocator_Temp
-    if (hash_table->allocator == &Allocator_Temp) return;
+hash_table_set(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value value) {
+    Value* ptr = hash_table_lookup(hash_table, key, Hash::hash(key));
+    Assert(ptr, "The key is not presented in the hash table.");
 
-    allocator_free(hash_table->allocator, hash_table->data);
-    allocator_free(hash_table->allocator, hash_table);
+    *ptr = value;
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_table_add_or_set(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value value) {
+    bool   inserted;
+    Value* ptr = hash_table_find_or_insert(hash_table, key, &inserted);
+
+    if (!ptr) {
+        Assert(false, "Hash table is full.");
+        return false;
+    }
+
+    *ptr = value;
+
+    return !inserted;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_add(Hash_Table<Key, Value>* hash_table, Key key, Value value) {
-    u32 hash      = get_hash(key);
-    Assert(hash != 0, "Hash cannot be 0, fix your hash function.");
-    u32 iteration = 0;
-    u32 index     = 0;
+hash_table_remove(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key) {
+    if (!hash_table_remove_if_contains(hash_table, key)) {
+        Assert(false, "The key was not presented in the hash table.");
+    }
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_table_remove_if_contains(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key) {
+    u64 hash  = Hash::hash(key);
+    u32 index = hash_table_find(hash_table, key, hash);
+
+    if (index != HASH_TABLE_NOT_FOUND) {
+        hash_table_erase_at(hash_table, index);
+    } else if (hash_table->old_control) {
+        index = hash_table_probe<Key, Equal>(hash_table->old_control, hash_table->old_keys, hash_table->old_length, key, hash);
+        if (index == HASH_TABLE_NOT_FOUND) return false;
+
+        // old arrays are never inserted into, deleted is enough
+        hash_table->old_control[index] = HASH_TABLE_DELETED;
+        hash_table->count--;
+    } else {
+        return false;
+    }
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+    if (hash_table->old_control) hash_table_migrate(hash_table, HASH_TABLE_MIGRATE_GROUPS);
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+    return true;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_table_contains(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key) {
+    return hash_table_lookup(hash_table, key, Hash::hash(key)) != null;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value
+hash_table_get(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key) {
+    Value* ptr = hash_table_lookup(hash_table, key, Hash::hash(key));
+    Assert(ptr, "The key was not presented in the hash table.");
+
+    return *ptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+hash_table_try_get(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, Value* value) {
+    Value* ptr = hash_table_lookup(hash_table, key, Hash::hash(key));
+
+    if (!ptr) {
+        return false;
     }
 
-    Assert(hash_table->data[index].hash != hash, "An item with the same key has already been added.");
+    *value = *ptr;
 
-    auto slot = Hash_Table_Slot<Value> {0};
-    slot.hash  = hash;
-    slot.value = value;
+    return true;
+}
 
-    hash_table->data[index] = slot;
-    hash_table->count++;
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+hash_table_get_ptr(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key) {
+    u64 hash  = Hash::hash(key);
+    u32 index = hash_table_find(hash_table, key, hash);
+
+    if (index != HASH_TABLE_NOT_FOUND) return &hash_table->values[index];
+    if (!hash_table->old_control) return null;
+
+    index = hash_table_probe<Key, Equal>(hash_table->old_control, hash_table->old_keys, hash_table->old_length, key, hash);
+    if (index == HASH_TABLE_NOT_FOUND) return null;
+
+    // removes and find_or_insert migrate and free the old arrays, the pointer must not point into them
+    return &hash_table->values[hash_table_take_old(hash_table, index, hash)];
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value*
+hash_table_find_or_insert(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, bool* inserted) {
+    u64 hash = Hash::hash(key);
+    u32 free;
+
+    if (hash_table->old_control) hash_table_migrate(hash_table, HASH_TABLE_MIGRATE_GROUPS);
+
+    u32 index = hash_table_find_or_free(hash_table, key, hash, &free);
+
+    if (index != HASH_TABLE_NOT_FOUND) {
+        if (inserted) *inserted = false;
+        return &hash_table->values[index];
+    }
 
-    u32 load_factor = hash_table->count * 100 / hash_table->length;
+    if (hash_table->old_control) {
+        index = hash_table_probe<Key, Equal>(hash_table->old_control, hash_table->old_keys, hash_table->old_length, key, hash);
 
-    if (load_factor >= HASH_TABLE_MAX_LOAD_FACTOR) {
-        hash_table_realloc(hash_table, hash_table->length + HASH_TABLE_REALLOC_STEP);
+        // not migrated yet, move it now, so the pointer stays valid until the next add
+        if (index != HASH_TABLE_NOT_FOUND) {
+            if (inserted) *inserted = false;
+            return &hash_table->values[hash_table_take_old(hash_table, index, hash)];
+        }
+    }
+
+    u8* control = hash_table->control;
+
+    if (!hash_table_grow_if_full(hash_table)) {
+        if (inserted) *inserted = false;
+        return null;
+    }
+
+    // rehashed, the free slot has moved
+    if (control != hash_table->control) {
+        free = hash_table_find_free(hash_table, hash);
     }
+
+    hash_table_insert_at(hash_table, free, hash, key, Value());
+
+    if (inserted) *inserted = true;
+
+    return &hash_table->values[free];
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_get_many(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, const Key* keys, u32 count, Value* values, bool* found) {
+    u64 hashes[HASH_TABLE_BATCH_SIZE];
+    u32 found_count = 0;
+
+    for (u32 batch = 0; batch < count; batch += HASH_TABLE_BATCH_SIZE) {
+        u32 size = count - batch < HASH_TABLE_BATCH_SIZE ? count - batch : HASH_TABLE_BATCH_SIZE;
+
+        // all the misses of the batch are in flight at the same time
+        for (u32 i = 0; i < size; i++) {
+            hashes[i] = Hash::hash(keys[batch + i]);
+            hash_table_prefetch(hash_table, hashes[i]);
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            u32 index = hash_table_first_match(hash_table, hashes[i]);
+            if (index == HASH_TABLE_NOT_FOUND) continue;
+
+            __builtin_prefetch(&hash_table->keys[index]);
+            __builtin_prefetch(&hash_table->values[index]);
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            Value* ptr = hash_table_lookup(hash_table, keys[batch + i], hashes[i]);
+
+            if (found) found[batch + i] = ptr != null;
+            if (!ptr) continue;
+
+            values[batch + i] = *ptr;
+            found_count++;
+        }
+    }
+
+    return found_count;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_contains_many(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, const Key* keys, u32 count, bool* found) {
+    u64 hashes[HASH_TABLE_BATCH_SIZE];
+    u32 found_count = 0;
+
+    for (u32 batch = 0; batch < count; batch += HASH_TABLE_BATCH_SIZE) {
+        u32 size = count - batch < HASH_TABLE_BATCH_SIZE ? count - batch : HASH_TABLE_BATCH_SIZE;
+
+        for (u32 i = 0; i < size; i++) {
+            hashes[i] = Hash::hash(keys[batch + i]);
+            hash_table_prefetch(hash_table, hashes[i]);
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            u32 index = hash_table_first_match(hash_table, hashes[i]);
+            if (index != HASH_TABLE_NOT_FOUND) __builtin_prefetch(&hash_table->keys[index]);
+        }
+
+        for (u32 i = 0; i < size; i++) {
+            found[batch + i] = hash_table_lookup(hash_table, keys[batch + i], hashes[i]) != null;
+            found_count += found[batch + i];
+        }
+    }
+
+    return found_count;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_set(Hash_Table<Key, Value>* hash_table, Key key, Value value) {
-    u32 hash      = get_hash(key);
-    u32 iteration = 0;
-    u32 index     = 0;
+hash_table_add_many(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, const Key* keys, const Value* values, u32 count) {
+    u64 hashes[HASH_TABLE_BATCH_SIZE];
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+    u64 needed = (u64)hash_table->count + count;
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+    if (needed * 100 > (u64)HASH_TABLE_MAX_LENGTH * HASH_TABLE_MAX_LOAD_FACTOR) {
+        Assert(false, "Hash table is full.");
+        return;
     }
 
-    Assert(hash_table->data[index].hash == hash, "The key is not presented in the hash table.");
+    hash_table_finish_resize(hash_table);
 
-    auto slot  = Hash_Table_Slot<Value> {0};
-    slot.hash  = hash;
-    slot.value = value;
+    // room for the whole batch, deleted slots included, so no key of it rehashes and prefetched slots stay valid
+    if ((needed + hash_table->deleted) * 100 > (u64)hash_table->length * HASH_TABLE_MAX_LOAD_FACTOR) {
+        u32 length = hash_table_length_for((u32)needed);
+
+        ALLOCATOR_TAG("hash_table_realloc");
+        hash_table_rehash(hash_table, length > hash_table->length ? length : hash_table->length);
+    }
+
+    for (u32 batch = 0; batch < count; batch += HASH_TABLE_BATCH_SIZE) {
+        u32 size = count - batch < HASH_TABLE_BATCH_SIZE ? count - batch : HASH_TABLE_BATCH_SIZE;
+
+        for (u32 i = 0; i < size; i++) {
+            hashes[i] = Hash::hash(keys[batch + i]);
+            hash_table_prefetch(hash_table, hashes[i]);
+        }
 
-    hash_table->data[index] = slot;
+        for (u32 i = 0; i < size; i++) {
+            // like hash_table_add, keys are compared only in debug builds
+            Assert(hash_table_find(hash_table, keys[batch + i], hashes[i]) == HASH_TABLE_NOT_FOUND, "An item with the same key has already been added.");
+
+            u32 index = hash_table_find_free(hash_table, hashes[i]);
+            hash_table_insert_at(hash_table, index, hashes[i], keys[batch + i], values[batch + i]);
+        }
+    }
 }
 
 template <typename Key, typename Value>
 static inline
+Hash_Table_Layout
+hash_table_layout(u32 length, u32 alignment) {
+    Hash_Table_Layout layout;
+
+    layout.alignment = alignment;
+    if (layout.alignment < alignof(Key))   layout.alignment = alignof(Key);
+    if (layout.alignment < alignof(Value)) layout.alignment = alignof(Value);
+
+    u64 align     = layout.alignment - 1;
+    layout.keys   = ((u64)length + align) & ~align;
+    layout.values = (layout.keys + sizeof(Key) * length + align) & ~align;
+    layout.size   = layout.values + sizeof(Value) * length;
+
+    return layout;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_allocate(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length) {
+    // at least one group, power of 2
+    if (length < HASH_TABLE_GROUP_WIDTH) length = HASH_TABLE_GROUP_WIDTH;
+    Assert(length <= 0x80000000, "Hash table length is too big.");
+    length = 1u << (32 - __builtin_clz(length - 1));
+
+    Hash_Table_Layout layout = hash_table_layout<Key, Value>(length, hash_table->alignment);
+
+    u8* data = (u8*)Alloc::alloc(hash_table->allocator, layout.size, layout.alignment);
+    Assert(data, "Cannot allocate memory for hash_table data.");
+
+    memset(data, HASH_TABLE_EMPTY, length);
+
+    hash_table_set_arrays(hash_table, data, length);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_set_arrays(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u8* data, u32 length) {
+    Hash_Table_Layout layout = hash_table_layout<Key, Value>(length, hash_table->alignment);
+
+    hash_table->control = data;
+    hash_table->keys    = (Key*)(data + layout.keys);
+    hash_table->values  = (Value*)(data + layout.values);
+    hash_table->deleted = 0;
+    hash_table->length  = length;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_rehash(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length) {
+    hash_table_finish_resize(hash_table);
+
+    // prepared for the length of an incremental resize, which is not coming
+    Alloc::free(hash_table->allocator, hash_table->next_data);
+    hash_table->next_data = null;
+
+    u8*    control    = hash_table->control;
+    Key*   keys       = hash_table->keys;
+    Value* values     = hash_table->values;
+    u32    old_length = hash_table->length;
+
+    hash_table_allocate(hash_table, length);
+
+    for (u32 i = 0; i < old_length; i++) {
+        if (control[i] & HASH_TABLE_EMPTY) continue;
+
+        u32 index = hash_table_find_free(hash_table, Hash::hash(keys[i]));
+
+        hash_table->control[index] = control[i];
+        hash_table->keys[index]    = keys[i];
+        hash_table->values[index]  = values[i];
+    }
+
+    Alloc::free(hash_table->allocator, control);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
 bool
-hash_table_add_or_set(Hash_Table<Key, Value>* hash_table, Key key, Value value) {
-    u32 hash      = get_hash(key);
-    u32 iteration = 0;
-    u32 index     = 0;
+hash_table_grow_if_full(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table) {
+    u64 limit = (u64)hash_table->length * HASH_TABLE_MAX_LOAD_FACTOR;
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+    if ((u64)(hash_table->count + hash_table->deleted + 1) * 100 <= limit) {
+        if (hash_table->flags & HASH_TABLE_INCREMENTAL) hash_table_prepare_resize(hash_table);
+        return true;
+    }
+
+    u32 length = hash_table_next_length(hash_table);
+    if (!length) return false;
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+    if (hash_table->flags & HASH_TABLE_INCREMENTAL) {
+        hash_table_start_resize(hash_table, length);
+    } else {
+        ALLOCATOR_TAG("hash_table_realloc");
+        hash_table_rehash(hash_table, length);
     }
 
-    bool has = false;
+    return true;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_next_length(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table) {
+    u32 length = hash_table->length;
+
+    if ((u64)(hash_table->count + 1) * 100 > (u64)length * HASH_TABLE_MIN_LOAD_FACTOR) {
+        // length is u32, it would wrap to 0
+        if (length > HASH_TABLE_MAX_LENGTH / HASH_TABLE_GROWTH_FACTOR) return 0;
 
-    if (hash_table->data[index].hash == hash) {
-        has = true;
+        length *= HASH_TABLE_GROWTH_FACTOR;
     }
 
-    auto slot = Hash_Table_Slot<Value> {0};
-    slot.hash  = hash;
-    slot.value = value;
-    hash_table->data[index] = slot;
+    return length;
+}
 
-    if (!has) {
-        hash_table->count++;
-        u32 load_factor = hash_table->count * 100 / hash_table->length;
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_start_resize(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 length) {
+    ALLOCATOR_TAG("hash_table_realloc");
+
+    // the previous resize is too slow to keep up, it's very unlikely with HASH_TABLE_MIGRATE_GROUPS > 1
+    hash_table_finish_resize(hash_table);
+
+    hash_table->old_control = hash_table->control;
+    hash_table->old_keys    = hash_table->keys;
+    hash_table->old_values  = hash_table->values;
+    hash_table->old_length  = hash_table->length;
+    hash_table->migrated    = 0;
+
+    if (hash_table->next_data && hash_table->next_length == length) {
+        // the adds since the prepare load have cleared it, see hash_table_prepare_resize. Nothing is left to clear
+        memset(hash_table->next_data + hash_table->next_cleared, HASH_TABLE_EMPTY, length - hash_table->next_cleared);
+        hash_table_set_arrays(hash_table, hash_table->next_data, length);
+    } else {
+        // removes have changed the length since the arrays were prepared
+        Alloc::free(hash_table->allocator, hash_table->next_data);
+        hash_table_allocate(hash_table, length);
+    }
 
-        if (load_factor >= HASH_TABLE_MAX_LOAD_FACTOR) {
-            hash_table_realloc(hash_table, hash_table->length + HASH_TABLE_REALLOC_STEP);
-        }
+    hash_table->next_data = null;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_prepare_resize(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table) {
+    u32 used = hash_table->count + hash_table->deleted;
+
+    if (!hash_table->next_data) {
+        if ((u64)(used + 1) * 100 <= (u64)hash_table->length * HASH_TABLE_PREPARE_LOAD_FACTOR) return;
+
+        u32 length = hash_table_next_length(hash_table);
+        if (!length) return;
+
+        ALLOCATOR_TAG("hash_table_realloc");
+        Hash_Table_Layout layout = hash_table_layout<Key, Value>(length, hash_table->alignment);
+
+        u8* data = (u8*)Alloc::alloc(hash_table->allocator, layout.size, layout.alignment);
+        if (!data) return;
+
+        // every add until the table is full clears its part, so all of it is empty by the resize
+        u32 adds = (u32)((u64)hash_table->length * HASH_TABLE_MAX_LOAD_FACTOR / 100) - used;
+
+        hash_table->next_data    = data;
+        hash_table->next_length  = length;
+        hash_table->next_cleared = 0;
+        hash_table->next_step    = (length + adds - 1) / adds;
     }
 
-    return has;
+    u32 size = hash_table->next_length - hash_table->next_cleared;
+    if (size > hash_table->next_step) size = hash_table->next_step;
+
+    memset(hash_table->next_data + hash_table->next_cleared, HASH_TABLE_EMPTY, size);
+    hash_table->next_cleared += size;
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
 void
-hash_table_remove(Hash_Table<Key, Value>* hash_table, Key key) {
-    u32 hash      = get_hash(key);
-    u32 iteration = 0;
-    u32 index     = 0;
+hash_table_migrate(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 groups) {
+    u32 old_groups = hash_table->old_length / HASH_TABLE_GROUP_WIDTH;
+    u32 end        = hash_table->migrated + groups < old_groups ? hash_table->migrated + groups : old_groups;
+
+    for (u32 i = hash_table->migrated * HASH_TABLE_GROUP_WIDTH; i < end * HASH_TABLE_GROUP_WIDTH; i++) {
+        u8 control = hash_table->old_control[i];
+        if (control & HASH_TABLE_EMPTY) continue;
+
+        u32 index = hash_table_find_free(hash_table, Hash::hash(hash_table->old_keys[i]));
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+        if (hash_table->control[index] == HASH_TABLE_DELETED) hash_table->deleted--;
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+        hash_table->control[index] = control;
+        hash_table->keys[index]    = hash_table->old_keys[i];
+        hash_table->values[index]  = hash_table->old_values[i];
+
+        // probe sequences of the old keys that are not migrated yet go through this slot
+        hash_table->old_control[i] = HASH_TABLE_DELETED;
     }
 
-    Assert(hash_table->data[index].hash == hash, "The key was not presented in the hash table.");
+    hash_table->migrated = end;
 
-    hash_table->data[index].tombstone = true;
-    hash_table->data[index].hash      = 0;
-    hash_table->data[index].value     = {0};
-    hash_table->count--;
+    if (end == old_groups) {
+        Alloc::free(hash_table->allocator, hash_table->old_control);
+        hash_table->old_control = null;
+    }
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
-bool
-hash_table_remove_if_contains(Hash_Table<Key, Value>* hash_table, Key key) {
-    u32 hash      = get_hash(key);
-    u32 iteration = 0;
-    u32 index     = 0;
+Value*
+hash_table_lookup(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, u64 hash) {
+    u32 index = hash_table_find(hash_table, key, hash);
+
+    if (index != HASH_TABLE_NOT_FOUND) return &hash_table->values[index];
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+    if (hash_table->old_control) {
+        index = hash_table_probe<Key, Equal>(hash_table->old_control, hash_table->old_keys, hash_table->old_length, key, hash);
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+        if (index != HASH_TABLE_NOT_FOUND) return &hash_table->old_values[index];
     }
 
-    if (hash_table->data[index].hash != hash) {
-        return false;
+    return null;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_take_old(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 index, u64 hash) {
+    u32 free = hash_table_find_free(hash_table, hash);
+
+    // the migration skips it now, and probe sequences through the slot still work
+    hash_table->old_control[index] = HASH_TABLE_DELETED;
+    hash_table->count--;
+    hash_table_insert_at(hash_table, free, hash, hash_table->old_keys[index], hash_table->old_values[index]);
+
+    return free;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_insert_at(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 index, u64 hash, Key key, Value value) {
+    if (hash_table->control[index] == HASH_TABLE_DELETED) hash_table->deleted--;
+
+    hash_table->control[index] = hash & 0x7F;
+    hash_table->keys[index]    = key;
+    hash_table->values[index]  = value;
+    hash_table->count++;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+hash_table_erase_at(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u32 index) {
+    u32 start = index & ~(HASH_TABLE_GROUP_WIDTH - 1);
+
+    if (hash_table_group_match_empty(&hash_table->control[start])) {
+        hash_table->control[index] = HASH_TABLE_EMPTY;
+    } else {
+        hash_table->control[index] = HASH_TABLE_DELETED;
+        hash_table->deleted++;
     }
 
-    hash_table->data[index].tombstone = true;
-    hash_table->data[index].hash      = 0;
-    hash_table->data[index].value     = {0};
     hash_table->count--;
+}
 
-    return true;
+static inline
+u32
+hash_table_length_for(u32 count) {
+    u64 length = HASH_TABLE_GROUP_WIDTH;
+
+    while (length * HASH_TABLE_MAX_LOAD_FACTOR < (u64)count * 100 && length < HASH_TABLE_MAX_LENGTH) {
+        length *= 2;
+    }
+
+    return (u32)length;
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
-bool
-hash_table_contains(Hash_Table<Key, Value>* hash_table, Key key) {
-    u32 hash      = get_hash(key);
-    u32 iteration = 0;
-    u32 index     = 0;
+u32
+hash_table_find(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, u64 hash) {
+    return hash_table_probe<Key, Equal>(hash_table->control, hash_table->keys, hash_table->length, key, hash);
+}
+
+template <typename Key, typename Equal>
+static inline
+u32
+hash_table_probe(const u8* control, const Key* keys, u32 length, Key key, u64 hash) {
+    u32 mask  = length / HASH_TABLE_GROUP_WIDTH - 1;
+    u32 group = (u32)(hash >> 7) & mask;
+    u8  h2    = hash & 0x7F;
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+    for (u32 probe = 1; probe <= mask + 1; probe++) {
+        u32       start = group * HASH_TABLE_GROUP_WIDTH;
+        const u8* ctrl  = &control[start];
+        u32       match = hash_table_group_match(ctrl, h2);
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+        while (match) {
+            u32 index = start + __builtin_ctz(match);
+
+            if (Equal::equal(keys[index], key)) return index;
+
+            match &= match - 1;
+        }
+
+        // the key would have been put into this group
+        if (hash_table_group_match_empty(ctrl)) break;
+
+        group = (group + probe) & mask;
     }
 
-    return hash_table->data[index].hash == hash;
+    return HASH_TABLE_NOT_FOUND;
 }
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
 static inline
-Value
-hash_table_get(Hash_Table<Key, Value>* hash_table, Key key) {
-    u32 hash      = get_hash(key);
-    u32 iteration = 0;
-    u32 index     = 0;
+void
+hash_table_prefetch(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u64 hash) {
+    u32 mask  = hash_table->length / HASH_TABLE_GROUP_WIDTH - 1;
+    u32 start = ((u32)(hash >> 7) & mask) * HASH_TABLE_GROUP_WIDTH;
+
+    __builtin_prefetch(&hash_table->control[start]);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_first_match(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u64 hash) {
+    u32 mask  = hash_table->length / HASH_TABLE_GROUP_WIDTH - 1;
+    u32 start = ((u32)(hash >> 7) & mask) * HASH_TABLE_GROUP_WIDTH;
+    u32 match = hash_table_group_match(&hash_table->control[start], hash & 0x7F);
+
+    return match ? start + __builtin_ctz(match) : HASH_TABLE_NOT_FOUND;
+}
 
-    while (true) {
-        index = hash_table_double_hash(hash, hash_table->length, iteration++);
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_find_or_free(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, Key key, u64 hash, u32* free) {
+    return hash_table_probe_or_free<Key, Equal>(hash_table->control, hash_table->keys, hash_table->length, key, hash, free);
+}
 
-        if (hash_table->data[index].tombstone)    continue;
-        if (hash_table->data[index].hash == hash) break;
-        if (hash_table->data[index].hash == 0)    break;
+template <typename Key, typename Equal>
+static inline
+u32
+hash_table_probe_or_free(const u8* control, const Key* keys, u32 length, Key key, u64 hash, u32* free) {
+    u32 mask  = length / HASH_TABLE_GROUP_WIDTH - 1;
+    u32 group = (u32)(hash >> 7) & mask;
+    u8  h2    = hash & 0x7F;
+
+    *free = HASH_TABLE_NOT_FOUND;
+
+    for (u32 probe = 1; probe <= mask + 1; probe++) {
+        u32       start = group * HASH_TABLE_GROUP_WIDTH;
+        const u8* ctrl  = &control[start];
+        u32       match = hash_table_group_match(ctrl, h2);
+
+        while (match) {
+            u32 index = start + __builtin_ctz(match);
+
+            if (Equal::equal(keys[index], key)) return index;
+
+            match &= match - 1;
+        }
+
+        if (*free == HASH_TABLE_NOT_FOUND) {
+            u32 free_match = hash_table_group_match_free(ctrl);
+            if (free_match) *free = start + __builtin_ctz(free_match);
+        }
+
+        if (hash_table_group_match_empty(ctrl)) break;
+
+        group = (group + probe) & mask;
     }
 
-    Assert(hash_table->data[index].hash == hash, "The key was not presented in the hash table.");
+    return HASH_TABLE_NOT_FOUND;
+}
 
-    return hash_table->data[index].value;
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+u32
+hash_table_find_free(Hash_Table<Key, Value, Alloc, Hash, Equal>* hash_table, u64 hash) {
+    return hash_table_probe_free(hash_table->control, hash_table->length, hash);
+}
+
+static inline
+u32
+hash_table_probe_free(const u8* control, u32 length, u64 hash) {
+    u32 mask  = length / HASH_TABLE_GROUP_WIDTH - 1;
+    u32 group = (u32)(hash >> 7) & mask;
+
+    for (u32 probe = 1; ; probe++) {
+        u32 start = group * HASH_TABLE_GROUP_WIDTH;
+        u32 match = hash_table_group_match_free(&control[start]);
+
+        if (match) return start + __builtin_ctz(match);
+
+        group = (group + probe) & mask;
+    }
 }
 
+#if defined(__SSE2__)
 static inline
 u32
-hash_table_double_hash(u32 hash, u32 length, u32 iteration) {
-    return (1 + (hash + iteration * (hash % (length / 2)))) % length;
-}
\ No newline at end of file
+hash_table_group_match(const u8* group, u8 control) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)control)));
+}
+
+static inline
+u32
+hash_table_group_match_empty(const u8* group) {
+    return hash_table_group_match(group, HASH_TABLE_EMPTY);
+}
+
+static inline
+u32
+hash_table_group_match_free(const u8* group) {
+    // empty and deleted are the only control bytes with the highest bit set
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+#else
+static inline
+u32
+hash_table_group_match(const u8* group, u8 control) {
+    u32 match = 0;
+
+    for (u32 i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+        match |= (u32)(group[i] == control) << i;
+    }
+
+    return match;
+}
+
+static inline
+u32
+hash_table_group_match_empty(const u8* group) {
+    return hash_table_group_match(group, HASH_TABLE_EMPTY);
+}
+
+static inline
+u32
+hash_table_group_match_free(const u8* group) {
+    u32 match = 0;
+
+    for (u32 i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+        match |= (u32)(group[i] >> 7) << i;
+    }
+
+    return match;
+}
+#endif
\ No newline at end of file
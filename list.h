@@ -7,7 +7,7 @@
 #define LIST_DEFAULT_LENGTH 256
 #define LIST_REALLOC_STEP 128
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 struct List {
     T*         data;
     u32        count;
@@ -30,108 +30,107 @@ struct List {
         return data[i];
     }
 
-    List(u32 length, Allocator* allocator = &Allocator_Std) : count(0),
+    List(u32 length, Allocator* allocator = Alloc::get_default()) : count(0),
                                                               length(length),
                                                               allocator(allocator) {
-        data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+        data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
         Assert(data, "Cannot allocate list data.");
     }
 
     ~List() {
-        if (allocator == &Allocator_Temp) return;
-
-        allocator_free(allocator, data);
+        Alloc::free(allocator, data);
     }
 };
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 static inline
-List<T>*
-list_make(u32 length = LIST_DEFAULT_LENGTH, Allocator* allocator = &Allocator_Std);
+List<T, Alloc>*
+list_make(u32 length = LIST_DEFAULT_LENGTH, Allocator* allocator = Alloc::get_default());
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_realloc(List<T> *list, u32 length);
+list_realloc(List<T, Alloc> *list, u32 length);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_free(List<T> *list);
+list_free(List<T, Alloc> *list);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_append(List<T> *list, T element);
+list_append(List<T, Alloc> *list, T element);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove(List<T> *list, T element);
+list_remove(List<T, Alloc> *list, T element);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove_swap_back(List<T> *list, T element);
+list_remove_swap_back(List<T, Alloc> *list, T element);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove_at(List<T> *list, u32 index);
+list_remove_at(List<T, Alloc> *list, u32 index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove_at_swap_back(List<T> *list, u32 index);
+list_remove_at_swap_back(List<T, Alloc> *list, u32 index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_set(List<T> *list, u32 index, T element);
+list_set(List<T, Alloc> *list, u32 index, T element);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-list_get(List<T> *list, u32 index);
+list_get(List<T, Alloc> *list, u32 index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T*
-list_get_ptr(List<T> *list, u32 index);
+list_get_ptr(List<T, Alloc> *list, u32 index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_quick_sort(List<T> *list);
+list_quick_sort(List<T, Alloc> *list);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_flush(List<T> *list);
+list_flush(List<T, Alloc> *list);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 bool
-list_contains(List<T> *list, T elem);
+list_contains(List<T, Alloc> *list, T elem);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 bool
-list_find(List<T> *list, T elem, u32* index);
+list_find(List<T, Alloc> *list, T elem, u32* index);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_clear(List<T> *list);
+list_clear(List<T, Alloc> *list);
 
 // Implementation
-template <typename T>
+template <typename T, typename Alloc>
 static inline
-List<T>*
+List<T, Alloc>*
 list_make(u32 length, Allocator* allocator) {
-    auto list = (List<T>*)allocator_alloc(allocator, sizeof(List<T>));
+    ALLOCATOR_TAG("list_make");
+    auto list = (List<T, Alloc>*)Alloc::alloc(allocator, sizeof(List<T, Alloc>), alignof(List<T, Alloc>));
     Assert(list, "Cannot allocate list.");
-    auto data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+    auto data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
     Assert(data, "Cannot allocate list data.");
 
     list->data      = data;
@@ -142,44 +141,30 @@ list_make(u32 length, Allocator* allocator) {
     return list;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_realloc(List<T> *list, u32 length) {
+list_realloc(List<T, Alloc> *list, u32 length) {
+    ALLOCATOR_TAG("list_realloc");
     Assert(length > list->length, "Cannot resize list with less size.");
 
-    if (list->allocator == &Allocator_Temp) {
-        T* new_data = (T*)allocator_alloc(list->allocator, sizeof(T) * length);
-        Assert(new_data, "Cannot allocate enough memory for new list");
-
-        for (u32 i = 0; i < list->count; i++) {
-            new_data[i] = list->data[i];
-        }
-
-        list->data = new_data;
-    } else {
-        list->data = (T*)allocator_realloc(list->allocator, list->data, sizeof(T) * length);
-    }
-
+    list->data = (T*)Alloc::realloc(list->allocator, list->data, sizeof(T) * list->length, sizeof(T) * length, alignof(T));
     Assert(list->data, "Cannot resize the list.");
     list->length = length;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_free(List<T> *list) {
-    // nothing to free if using Allocator_Temp
-    if (list->allocator == &Allocator_Temp) return;
-
-    allocator_free(list->allocator, list->data);
-    allocator_free(list->allocator, list);
+list_free(List<T, Alloc> *list) {
+    Alloc::free(list->allocator, list->data);
+    Alloc::free(list->allocator, list);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_append(List<T> *list, T element) {
+list_append(List<T, Alloc> *list, T element) {
     if (list->count >= list->length) {
         list_realloc(list, list->length + 1 + LIST_REALLOC_STEP);
     }
@@ -187,10 +172,10 @@ list_append(List<T> *list, T element) {
     list->data[list->count++] = element;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove(List<T> *list, T element) {
+list_remove(List<T, Alloc> *list, T element) {
     u32 i = 0;
     for(; i < list->count; i++) {
         if (list->data[i] == element) {
@@ -204,10 +189,10 @@ list_remove(List<T> *list, T element) {
     }
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove_swap_back(List<T> *list, T element) {
+list_remove_swap_back(List<T, Alloc> *list, T element) {
     for(u32 i = 0; i < list->count; i++) {
         if (list->data[i] == element) {
             list->data[i] = list->data[--list->count];
@@ -216,10 +201,10 @@ list_remove_swap_back(List<T> *list, T element) {
     }
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove_at(List<T> *list, u32 index) {
+list_remove_at(List<T, Alloc> *list, u32 index) {
     Assert(index < list->count, "Index outside the bounds of the list");
     list->count--;
     for (u32 i = index; i < list->count; i++) {
@@ -227,34 +212,34 @@ list_remove_at(List<T> *list, u32 index) {
     }
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_remove_at_swap_back(List<T> *list, u32 index) {
+list_remove_at_swap_back(List<T, Alloc> *list, u32 index) {
     Assert(index < list->count, "Index outside the bounds of the list");
     list->data[index] = list->data[--list->count];
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_set(List<T> *list, u32 index, T element) {
+list_set(List<T, Alloc> *list, u32 index, T element) {
     Assert(index < list->count, "Index outside the bounds of the list");
     list->data[index] = element;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-list_get(List<T> *list, u32 index) {
+list_get(List<T, Alloc> *list, u32 index) {
     Assert(index < list->count, "Index outside the bounds of the list");
     return list->data[index];
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T*
-list_get_ptr(List<T> *list, u32 index) {
+list_get_ptr(List<T, Alloc> *list, u32 index) {
     Assert(index < list->count, "Index outside the bounds of the list");
     return &list->data[index];
 }
@@ -291,34 +276,34 @@ quick_sort(T *arr, u32 low, u32 high) {
     }
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_quick_sort(List<T> *list) {
+list_quick_sort(List<T, Alloc> *list) {
     quick_sort(list->data, 0, list->count);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_flush(List<T> *list) {
+list_flush(List<T, Alloc> *list) {
     list->count = 0;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 bool
-list_contains(List<T> *list, T elem) {
+list_contains(List<T, Alloc> *list, T elem) {
     for (u32 i = 0; i < list->count; i++) {
         if (list->data[i] == elem) return true;
     }
     return false;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 bool
-list_find(List<T> *list, T elem, u32* index) {
+list_find(List<T, Alloc> *list, T elem, u32* index) {
     for (u32 i = 0; i < list->count; i++) {
         if (list->data[i] == elem) {
             *index = i;
@@ -330,10 +315,10 @@ list_find(List<T> *list, T elem, u32* index) {
 
 // Predicate should match signature:
 // bool (*name)(T*)
-template <typename T, typename Predicate>
+template <typename T, typename Alloc, typename Predicate>
 static inline
 bool
-list_find_by_descr(List<T> *list, Predicate descr, T* elem) {
+list_find_by_descr(List<T, Alloc> *list, Predicate descr, T* elem) {
     for (u32 i = 0; i < list->count; i++) {
         if (descr(&list->data[i])) {
             *elem = list->data[i];
@@ -343,9 +328,9 @@ list_find_by_descr(List<T> *list, Predicate descr, T* elem) {
     return false;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-list_clear(List<T> *list) {
+list_clear(List<T, Alloc> *list) {
     list->count = 0;
 }
\ No newline at end of file
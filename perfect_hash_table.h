@@ -0,0 +1,610 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include "hash_functions.h"
+#include "hash_table.h"
+#include "list.h"
+#include <memory.h>
+#include <stdio.h>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define PERFECT_HASH_TABLE_MMAP
+#endif
+
+#define PERFECT_HASH_TABLE_MAGIC         0x31454c4241544850ull // "PHTABLE1"
+#define PERFECT_HASH_TABLE_VERSION       1
+#define PERFECT_HASH_TABLE_BUCKET_FACTOR 5  // buckets = 5 * count / log2(count)
+#define PERFECT_HASH_TABLE_LOAD_FACTOR   97 // slots = count * 100 / 97, the rest is remapped
+#define PERFECT_HASH_TABLE_MAX_PILOT     (1u << 20)
+#define PERFECT_HASH_TABLE_MAX_ATTEMPTS  32 // seeds to try before giving up
+// 60% of hashes go to the first 30% of buckets, so big buckets are placed while the table is empty
+#define PERFECT_HASH_TABLE_DENSE_HASHES  0x9999999999999999ull
+#define PERFECT_HASH_TABLE_DENSE_BUCKETS 30
+
+// Perfect hash table flags
+#define PERFECT_HASH_TABLE_MAPPED 0x1 // data is a file mapping
+
+/*
+    Perfect_Hash_Table is an immutable table built once from known keys (PTHash).
+    Keys are split into buckets by hash, every bucket gets a pilot, so that hash(key) ^ hash(pilot) puts
+    all keys of all buckets into different slots. Slots past count are remapped into the free slots below it,
+    so the entries array has exactly count entries.
+
+    The table is one flat block: header, pilots, remap and entries, addressed by offsets from the start.
+    It can be saved to a file and mapped back with perfect_hash_table_open: lookups read the mapping directly,
+    one pilot and one entry, nothing is rebuilt. Keys and values are stored as bytes, so they must be trivially
+    copyable and must not be pointers (no const char* keys), and Hash must give the same hashes in every process.
+    The file is in the byte order of the machine that built it.
+*/
+struct Perfect_Hash_Table_Header {
+    u64 magic;
+    u32 version;
+    u32 key_size;
+    u32 value_size;
+    u32 entry_size;
+    u64 seed;
+    u32 count;
+    u32 slots;
+    u32 buckets;
+    u32 dense_buckets;
+    u64 dense_scale;  // bucket = mulhi(hash, dense_scale) for dense hashes
+    u64 sparse_scale; // dense_buckets + mulhi(hash - PERFECT_HASH_TABLE_DENSE_HASHES, sparse_scale) for the rest
+    u64 pilots;       // offsets from the start of the block
+    u64 remap;
+    u64 entries;
+    u64 size;
+};
+
+template <typename Key, typename Value>
+struct Perfect_Hash_Table_Entry {
+    Key   key;
+    Value value;
+};
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+struct Perfect_Hash_Table {
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "Keys and values are stored in the file as bytes.");
+
+    const Perfect_Hash_Table_Header*            header;
+    const u32*                                  pilots;
+    const u32*                                  remap;
+    const Perfect_Hash_Table_Entry<Key, Value>* entries;
+    u32                                         flags;
+    Allocator*                                  allocator;
+};
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_build(const Key* keys, const Value* values, u32 count, Allocator* allocator = Alloc::get_default()); // Returns null if a key is repeated or no seed gives pilots to all buckets.
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal, typename Table_Alloc>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_build(Hash_Table<Key, Value, Table_Alloc, Hash, Equal>* hash_table, Allocator* allocator = Alloc::get_default()); // Returns null if no seed gives pilots to all buckets.
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal, typename List_Alloc>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_build(List<Perfect_Hash_Table_Entry<Key, Value>, List_Alloc>* list, Allocator* allocator = Alloc::get_default()); // Returns null if a key is repeated or no seed gives pilots to all buckets.
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_open(const char* path, Allocator* allocator = Alloc::get_default()); // Maps the file. Returns null if it can't be read or is not a table of Key and Value.
+
+template <typename Key, typename Value, typename Alloc = Dynamic_Alloc, typename Hash = Default_Hash, typename Equal = Default_Equal>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_view(const void* data, u64 size, Allocator* allocator = Alloc::get_default()); // Uses the block in place, the caller keeps it alive. Returns null if it is not a table of Key and Value.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+perfect_hash_table_save(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, const char* path);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+perfect_hash_table_free(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+const Value*
+perfect_hash_table_get_ptr(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key); // Returns pointer to the value or null.
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value
+perfect_hash_table_get(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+perfect_hash_table_try_get(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key, Value* value);
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+perfect_hash_table_contains(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key);
+
+static inline
+u64
+perfect_hash_table_mulhi(u64 a, u64 b);
+
+static inline
+u32
+perfect_hash_table_bucket(const Perfect_Hash_Table_Header* header, u64 hash);
+
+static inline
+u32
+perfect_hash_table_slot(const Perfect_Hash_Table_Header* header, u64 slot_hash, u32 pilot); // Slot before remapping.
+
+static inline
+u64
+perfect_hash_table_slot_hash(u64 hash); // Hash for the slot, independent of the bucket.
+
+// Implementation
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_build(const Key* keys, const Value* values, u32 count, Allocator* allocator) {
+    ALLOCATOR_TAG("perfect_hash_table_build");
+
+    Perfect_Hash_Table_Header header = {};
+    header.magic      = PERFECT_HASH_TABLE_MAGIC;
+    header.version    = PERFECT_HASH_TABLE_VERSION;
+    header.key_size   = sizeof(Key);
+    header.value_size = sizeof(Value);
+    header.entry_size = sizeof(Perfect_Hash_Table_Entry<Key, Value>);
+    header.count      = count;
+    header.slots      = (u32)(((u64)count * 100 + PERFECT_HASH_TABLE_LOAD_FACTOR - 1) / PERFECT_HASH_TABLE_LOAD_FACTOR);
+
+    u32 log2 = 1;
+    while ((1ull << (log2 + 1)) <= count) log2++;
+
+    header.buckets       = (u32)((u64)count * PERFECT_HASH_TABLE_BUCKET_FACTOR / log2) + 2;
+    header.dense_buckets = header.buckets * PERFECT_HASH_TABLE_DENSE_BUCKETS / 100 + 1;
+    header.dense_scale   = (u64)header.dense_buckets * 5 / 3;                    // hash < 0.6 * 2^64
+    header.sparse_scale  = (u64)(header.buckets - header.dense_buckets) * 5 / 2; // hash - 0.6 * 2^64 < 0.4 * 2^64
+
+    u64 alignment = alignof(Perfect_Hash_Table_Entry<Key, Value>) > CACHE_LINE_SIZE ? alignof(Perfect_Hash_Table_Entry<Key, Value>) : CACHE_LINE_SIZE;
+
+    header.pilots  = sizeof(Perfect_Hash_Table_Header);
+    header.remap   = header.pilots + sizeof(u32) * header.buckets;
+    header.entries = (header.remap + sizeof(u32) * (header.slots - count) + alignment - 1) & ~(alignment - 1);
+    header.size    = header.entries + sizeof(Perfect_Hash_Table_Entry<Key, Value>) * count;
+
+    u8* data = (u8*)Alloc::alloc(allocator, header.size, alignment);
+    Assert(data, "Cannot allocate memory for perfect hash table.");
+    memset(data, 0, header.size);
+
+    u32* pilots = (u32*)(data + header.pilots);
+    u32* remap  = (u32*)(data + header.remap);
+    auto entries = (Perfect_Hash_Table_Entry<Key, Value>*)(data + header.entries);
+
+    // scratch: hashes, slot hashes, taken slots, buckets of keys, keys sorted by bucket, bucket starts, buckets sorted by size
+    u64 bitmap  = ((u64)header.slots + 63) / 64;
+    u64 scratch = sizeof(u64) * count * 2 + sizeof(u64) * bitmap + sizeof(u32) * count * 2 + sizeof(u32) * (header.buckets + 1) * 2;
+
+    u8* memory = (u8*)Alloc::alloc(allocator, scratch, alignof(u64));
+    Assert(memory, "Cannot allocate memory for perfect hash table build.");
+
+    u64* hashes      = (u64*)memory;
+    u64* slot_hashes = hashes + count;
+    u64* taken       = slot_hashes + count;
+    u32* bucket      = (u32*)(taken + bitmap);
+    u32* sorted      = bucket + count;
+    u32* starts      = sorted + count; // first key of every bucket in sorted
+    u32* order       = starts + header.buckets + 1;
+
+    bool built     = false;
+    bool duplicate = false;
+
+    for (u32 attempt = 0; attempt < PERFECT_HASH_TABLE_MAX_ATTEMPTS && !built && !duplicate; attempt++) {
+        header.seed = hash_u64(attempt + 1);
+
+        memset(starts, 0, sizeof(u32) * (header.buckets + 1));
+        memset(taken, 0, sizeof(u64) * bitmap);
+
+        for (u32 i = 0; i < count; i++) {
+            hashes[i] = hash_u64(Hash::hash(keys[i]) ^ header.seed);
+            bucket[i] = perfect_hash_table_bucket(&header, hashes[i]);
+            starts[bucket[i] + 1]++;
+        }
+
+        u32 max_size = 0;
+        for (u32 b = 0; b < header.buckets; b++) {
+            if (starts[b + 1] > max_size) max_size = starts[b + 1];
+            starts[b + 1] += starts[b];
+        }
+
+        // counting sort of keys by bucket, order is used as cursors for a moment
+        memcpy(order, starts, sizeof(u32) * header.buckets);
+        for (u32 i = 0; i < count; i++) {
+            sorted[order[bucket[i]]++] = i;
+        }
+
+        // in bucket order, so the pilot search reads them sequentially
+        for (u32 i = 0; i < count; i++) {
+            slot_hashes[i] = perfect_hash_table_slot_hash(hashes[sorted[i]]);
+        }
+
+        // keys with the same hash in one bucket never get a pilot
+        bool collision = false;
+        for (u32 b = 0; b < header.buckets && !collision; b++) {
+            for (u32 i = starts[b]; i < starts[b + 1] && !collision; i++) {
+                for (u32 j = starts[b]; j < i; j++) {
+                    if (hashes[sorted[i]] == hashes[sorted[j]]) {
+                        // every seed gives equal keys equal hashes, no reason to try another one
+                        duplicate = Equal::equal(keys[sorted[i]], keys[sorted[j]]);
+                        collision = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (collision) continue;
+
+        // biggest buckets first, counting sort by size
+        u32 position = 0;
+        for (u32 size = max_size; size > 0; size--) {
+            for (u32 b = 0; b < header.buckets; b++) {
+                if (starts[b + 1] - starts[b] == size) order[position++] = b;
+            }
+        }
+
+        memset(pilots, 0, sizeof(u32) * header.buckets);
+
+        built = true;
+
+        for (u32 o = 0; o < position && built; o++) {
+            u32 b     = order[o];
+            u32 pilot = 0;
+
+            for (; pilot < PERFECT_HASH_TABLE_MAX_PILOT; pilot++) {
+                u32 i = starts[b];
+
+                for (; i < starts[b + 1]; i++) {
+                    u32 slot = perfect_hash_table_slot(&header, slot_hashes[i], pilot);
+                    if (taken[slot / 64] & (1ull << (slot % 64))) break;
+                    taken[slot / 64] |= 1ull << (slot % 64);
+                }
+
+                if (i == starts[b + 1]) break;
+
+                // undo the slots of this pilot
+                for (u32 j = starts[b]; j < i; j++) {
+                    u32 slot = perfect_hash_table_slot(&header, slot_hashes[j], pilot);
+                    taken[slot / 64] &= ~(1ull << (slot % 64));
+                }
+            }
+
+            if (pilot == PERFECT_HASH_TABLE_MAX_PILOT) {
+                built = false;
+            }
+
+            pilots[b] = pilot;
+        }
+    }
+
+    if (!built) {
+        Alloc::free(allocator, memory);
+        Alloc::free(allocator, data);
+        return null;
+    }
+
+    // taken slots past count go to the free slots below it
+    u32 free = 0;
+    for (u32 slot = count; slot < header.slots; slot++) {
+        if (!(taken[slot / 64] & (1ull << (slot % 64)))) continue;
+
+        while (taken[free / 64] & (1ull << (free % 64))) free++;
+
+        remap[slot - count] = free++;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        u32 slot = perfect_hash_table_slot(&header, slot_hashes[i], pilots[bucket[sorted[i]]]);
+        if (slot >= count) slot = remap[slot - count];
+
+        entries[slot].key   = keys[sorted[i]];
+        entries[slot].value = values[sorted[i]];
+    }
+
+    memcpy(data, &header, sizeof(header));
+
+    Alloc::free(allocator, memory);
+
+    auto table = perfect_hash_table_view<Key, Value, Alloc, Hash, Equal>(data, header.size, allocator);
+    Assert(table, "Cannot allocate memory for perfect hash table.");
+
+    if (!table) Alloc::free(allocator, data);
+
+    return table;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal, typename Table_Alloc>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_build(Hash_Table<Key, Value, Table_Alloc, Hash, Equal>* hash_table, Allocator* allocator) {
+    ALLOCATOR_TAG("perfect_hash_table_build");
+
+    hash_table_finish_resize(hash_table);
+
+    Key*   keys   = (Key*)Alloc::alloc(allocator, sizeof(Key) * hash_table->count, alignof(Key));
+    Value* values = (Value*)Alloc::alloc(allocator, sizeof(Value) * hash_table->count, alignof(Value));
+    Assert((keys && values) || hash_table->count == 0, "Cannot allocate memory for perfect hash table build.");
+
+    u32 count = 0;
+    for (u32 i = 0; i < hash_table->length; i++) {
+        if (hash_table->control[i] & HASH_TABLE_EMPTY) continue;
+
+        keys[count]   = hash_table->keys[i];
+        values[count] = hash_table->values[i];
+        count++;
+    }
+
+    auto table = perfect_hash_table_build<Key, Value, Alloc, Hash, Equal>(keys, values, count, allocator);
+
+    Alloc::free(allocator, keys);
+    Alloc::free(allocator, values);
+
+    return table;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal, typename List_Alloc>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_build(List<Perfect_Hash_Table_Entry<Key, Value>, List_Alloc>* list, Allocator* allocator) {
+    ALLOCATOR_TAG("perfect_hash_table_build");
+
+    Key*   keys   = (Key*)Alloc::alloc(allocator, sizeof(Key) * list->count, alignof(Key));
+    Value* values = (Value*)Alloc::alloc(allocator, sizeof(Value) * list->count, alignof(Value));
+    Assert((keys && values) || list->count == 0, "Cannot allocate memory for perfect hash table build.");
+
+    for (u32 i = 0; i < list->count; i++) {
+        keys[i]   = list->data[i].key;
+        values[i] = list->data[i].value;
+    }
+
+    auto table = perfect_hash_table_build<Key, Value, Alloc, Hash, Equal>(keys, values, list->count, allocator);
+
+    Alloc::free(allocator, keys);
+    Alloc::free(allocator, values);
+
+    return table;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_open(const char* path, Allocator* allocator) {
+    ALLOCATOR_TAG("perfect_hash_table_open");
+
+#ifdef PERFECT_HASH_TABLE_MMAP
+    int file = open(path, O_RDONLY);
+    if (file < 0) return null;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size < (off_t)sizeof(Perfect_Hash_Table_Header)) {
+        close(file);
+        return null;
+    }
+
+    u64 size = (u64)info.st_size;
+
+    // pages are read on the first lookup that touches them
+    void* data = mmap(null, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED) return null;
+
+    auto table = perfect_hash_table_view<Key, Value, Alloc, Hash, Equal>(data, size, allocator);
+    if (!table) {
+        munmap(data, size);
+        return null;
+    }
+
+    table->flags |= PERFECT_HASH_TABLE_MAPPED;
+
+    return table;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) return null;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size < (long)sizeof(Perfect_Hash_Table_Header)) {
+        fclose(file);
+        return null;
+    }
+
+    void* data = Alloc::alloc(allocator, (u64)size, CACHE_LINE_SIZE);
+    Assert(data, "Cannot allocate memory for perfect hash table.");
+
+    bool read = fread(data, 1, (u64)size, file) == (u64)size;
+    fclose(file);
+
+    auto table = read ? perfect_hash_table_view<Key, Value, Alloc, Hash, Equal>(data, (u64)size, allocator) : null;
+    if (!table) Alloc::free(allocator, data);
+
+    return table;
+#endif
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*
+perfect_hash_table_view(const void* data, u64 size, Allocator* allocator) {
+    auto header = (const Perfect_Hash_Table_Header*)data;
+
+    if (size < sizeof(Perfect_Hash_Table_Header)
+        || header->magic         != PERFECT_HASH_TABLE_MAGIC
+        || header->version       != PERFECT_HASH_TABLE_VERSION
+        || header->key_size      != sizeof(Key)
+        || header->value_size    != sizeof(Value)
+        || header->entry_size    != sizeof(Perfect_Hash_Table_Entry<Key, Value>)
+        || header->size          != size
+        || header->slots         < header->count
+        || header->dense_buckets > header->buckets) {
+        return null;
+    }
+
+    // offsets are checked against size first, so the sums below don't overflow
+    if (header->pilots < sizeof(Perfect_Hash_Table_Header)
+        || header->pilots  > size
+        || header->remap   > size
+        || header->entries > size
+        || header->pilots % alignof(u32) != 0
+        || header->remap % alignof(u32) != 0
+        || header->entries % alignof(Perfect_Hash_Table_Entry<Key, Value>) != 0
+        || header->pilots + sizeof(u32) * header->buckets > header->remap
+        || header->remap + sizeof(u32) * (header->slots - header->count) > header->entries
+        || header->entries + sizeof(Perfect_Hash_Table_Entry<Key, Value>) * header->count > size) {
+        return null;
+    }
+
+    // the largest hashes of both ranges must still land on a bucket with a pilot
+    if (perfect_hash_table_mulhi(PERFECT_HASH_TABLE_DENSE_HASHES - 1, header->dense_scale) >= header->dense_buckets
+        || perfect_hash_table_mulhi(~0ull - PERFECT_HASH_TABLE_DENSE_HASHES, header->sparse_scale) >= header->buckets - header->dense_buckets) {
+        return null;
+    }
+
+    const u32* remap = (const u32*)((const u8*)data + header->remap);
+
+    for (u32 i = 0; i < header->slots - header->count; i++) {
+        if (remap[i] >= header->count) return null;
+    }
+
+    auto table = (Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>*)Alloc::alloc(allocator, sizeof(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>), alignof(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>));
+    if (!table) return null;
+
+    table->header    = header;
+    table->pilots    = (const u32*)((const u8*)data + header->pilots);
+    table->remap     = remap;
+    table->entries   = (const Perfect_Hash_Table_Entry<Key, Value>*)((const u8*)data + header->entries);
+    table->flags     = 0;
+    table->allocator = allocator;
+
+    return table;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+perfect_hash_table_save(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    bool written = fwrite(table->header, 1, table->header->size, file) == table->header->size;
+
+    return fclose(file) == 0 && written;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+void
+perfect_hash_table_free(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table) {
+#ifdef PERFECT_HASH_TABLE_MMAP
+    if (table->flags & PERFECT_HASH_TABLE_MAPPED) {
+        munmap((void*)table->header, table->header->size);
+    } else {
+        Alloc::free(table->allocator, (void*)table->header);
+    }
+#else
+    Alloc::free(table->allocator, (void*)table->header);
+#endif
+
+    Alloc::free(table->allocator, table);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+const Value*
+perfect_hash_table_get_ptr(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key) {
+    const Perfect_Hash_Table_Header* header = table->header;
+
+    if (header->count == 0) return null;
+
+    u64 hash = hash_u64(Hash::hash(key) ^ header->seed);
+    u32 slot = perfect_hash_table_slot(header, perfect_hash_table_slot_hash(hash), table->pilots[perfect_hash_table_bucket(header, hash)]);
+
+    if (slot >= header->count) slot = table->remap[slot - header->count];
+
+    // keys that were not in the build land on some other key
+    const Perfect_Hash_Table_Entry<Key, Value>* entry = &table->entries[slot];
+
+    return Equal::equal(entry->key, key) ? &entry->value : null;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+Value
+perfect_hash_table_get(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key) {
+    const Value* ptr = perfect_hash_table_get_ptr(table, key);
+    Assert(ptr, "The key was not presented in the perfect hash table.");
+
+    return *ptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+perfect_hash_table_try_get(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key, Value* value) {
+    const Value* ptr = perfect_hash_table_get_ptr(table, key);
+
+    if (!ptr) {
+        return false;
+    }
+
+    *value = *ptr;
+
+    return true;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Hash, typename Equal>
+static inline
+bool
+perfect_hash_table_contains(Perfect_Hash_Table<Key, Value, Alloc, Hash, Equal>* table, Key key) {
+    return perfect_hash_table_get_ptr(table, key) != null;
+}
+
+static inline
+u64
+perfect_hash_table_mulhi(u64 a, u64 b) {
+    return (u64)(((__uint128_t)a * b) >> 64);
+}
+
+static inline
+u32
+perfect_hash_table_bucket(const Perfect_Hash_Table_Header* header, u64 hash) {
+    if (hash < PERFECT_HASH_TABLE_DENSE_HASHES) {
+        return (u32)perfect_hash_table_mulhi(hash, header->dense_scale);
+    }
+
+    return header->dense_buckets + (u32)perfect_hash_table_mulhi(hash - PERFECT_HASH_TABLE_DENSE_HASHES, header->sparse_scale);
+}
+
+static inline
+u32
+perfect_hash_table_slot(const Perfect_Hash_Table_Header* header, u64 slot_hash, u32 pilot) {
+    return (u32)perfect_hash_table_mulhi(slot_hash ^ hash_u64(pilot), header->slots);
+}
+
+static inline
+u64
+perfect_hash_table_slot_hash(u64 hash) {
+    return hash_u64(hash ^ HASH_SECRET_0);
+}
\ No newline at end of file
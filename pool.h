@@ -0,0 +1,220 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <malloc.h>
+#include <stdlib.h>
+
+// 64KB slabs by default
+#define POOL_SLAB_SIZE 64 * 1024
+
+/*
+    Pool hands out cells of one fixed size. Slabs are carved into cells lazily, freed cells
+    are linked into an intrusive free list, so both alloc and free are O(1).
+    The pool grows slab by slab and never gives memory back until it's destroyed.
+*/
+struct Pool_Slab {
+    Pool_Slab* next;
+};
+
+struct Pool_Cell {
+    Pool_Cell* next;
+};
+
+struct Pool {
+    Pool_Cell* free_list;
+    Pool_Slab* slabs;
+    u8*        bump;      // next never used cell of the newest slab
+    u8*        bump_end;
+    u64        cell_size;
+    u64        cells_per_slab;
+    u64        alignment;
+};
+
+static inline
+Pool*
+pool_make(u64 cell_size, u64 cells_per_slab = 0, u64 alignment = ALLOCATOR_DEFAULT_ALIGNMENT); // cells_per_slab = 0 fits as many cells as possible into POOL_SLAB_SIZE.
+
+static inline
+void
+pool_destroy(Pool* pool);
+
+static inline
+void*
+pool_get(Pool* pool);
+
+static inline
+void
+pool_put(Pool* pool, void* ptr);
+
+static inline
+Allocator
+pool_allocator_make(Pool* pool);
+
+static inline
+void*
+pool_alloc(Allocator* allocator, u64 size);
+
+static inline
+void*
+pool_alloc_aligned(Allocator* allocator, u64 size, u64 alignment);
+
+static inline
+void*
+pool_realloc(Allocator* allocator, void* ptr, u64 size); // Cells cannot grow, size must fit into the cell.
+
+static inline
+void
+pool_free(Allocator* allocator, void* ptr);
+
+static inline
+void
+pool_add_slab(Pool* pool);
+
+// Implementation
+static inline
+Pool*
+pool_make(u64 cell_size, u64 cells_per_slab, u64 alignment) {
+    Assert((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2.");
+    Pool* pool = (Pool*)malloc(sizeof(Pool));
+    Assert(pool, "Cannot allocate pool.");
+
+    // every cell must be able to hold the free list link and keep the alignment of the next one
+    if (cell_size < sizeof(Pool_Cell)) cell_size = sizeof(Pool_Cell);
+    cell_size = (cell_size + alignment - 1) & ~(alignment - 1);
+
+    if (cells_per_slab == 0) {
+        cells_per_slab = POOL_SLAB_SIZE / cell_size;
+        if (cells_per_slab == 0) cells_per_slab = 1;
+    }
+
+    pool->free_list      = null;
+    pool->slabs          = null;
+    pool->bump           = null;
+    pool->bump_end       = null;
+    pool->cell_size      = cell_size;
+    pool->cells_per_slab = cells_per_slab;
+    pool->alignment      = alignment;
+
+    return pool;
+}
+
+static inline
+void
+pool_destroy(Pool* pool) {
+    Pool_Slab* slab = pool->slabs;
+
+    while (slab) {
+        Pool_Slab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    free(pool);
+}
+
+static inline
+void*
+pool_get(Pool* pool) {
+    Pool_Cell* cell = pool->free_list;
+
+    if (cell) {
+        pool->free_list = cell->next;
+        return cell;
+    }
+
+    if (pool->bump == pool->bump_end) {
+        pool_add_slab(pool);
+    }
+
+    void* ptr = pool->bump;
+
+    pool->bump += pool->cell_size;
+
+    return ptr;
+}
+
+static inline
+void
+pool_put(Pool* pool, void* ptr) {
+    Pool_Cell* cell = (Pool_Cell*)ptr;
+
+    cell->next      = pool->free_list;
+    pool->free_list = cell;
+}
+
+static inline
+Allocator
+pool_allocator_make(Pool* pool) {
+    Allocator allocator = {
+        .alloc         = pool_alloc,
+        .alloc_aligned = pool_alloc_aligned,
+        .realloc       = pool_realloc,
+        .free          = pool_free,
+        .context       = pool
+    };
+
+    return allocator;
+}
+
+static inline
+void*
+pool_alloc(Allocator* allocator, u64 size) {
+    Pool* pool = (Pool*)allocator->context;
+    Assert(size <= pool->cell_size, "Cannot allocate more than a cell size from pool.");
+
+    return pool_get(pool);
+}
+
+static inline
+void*
+pool_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    Pool* pool = (Pool*)allocator->context;
+    Assert(size <= pool->cell_size, "Cannot allocate more than a cell size from pool.");
+    Assert(alignment <= pool->alignment, "Pool cells are not aligned enough.");
+
+    return pool_get(pool);
+}
+
+static inline
+void*
+pool_realloc(Allocator* allocator, void* ptr, u64 size) {
+    Pool* pool = (Pool*)allocator->context;
+    Assert(size <= pool->cell_size, "Cannot realloc more than a cell size, using pool allocator.");
+
+    if (!ptr) return pool_get(pool);
+
+    return ptr;
+}
+
+static inline
+void
+pool_free(Allocator* allocator, void* ptr) {
+    if (!ptr) return;
+
+    pool_put((Pool*)allocator->context, ptr);
+}
+
+static inline
+void
+pool_add_slab(Pool* pool) {
+    // cells start after the slab header, padded to the alignment
+    u64 header = (sizeof(Pool_Slab) + pool->alignment - 1) & ~(pool->alignment - 1);
+    u64 size   = header + pool->cell_size * pool->cells_per_slab;
+
+    Pool_Slab* slab;
+
+    if (pool->alignment <= ALLOCATOR_DEFAULT_ALIGNMENT) {
+        slab = (Pool_Slab*)malloc(size);
+    } else {
+        slab = (Pool_Slab*)aligned_alloc(pool->alignment, (size + pool->alignment - 1) & ~(pool->alignment - 1));
+    }
+
+    Assert(slab, "Cannot allocate pool slab.");
+
+    slab->next     = pool->slabs;
+    pool->slabs    = slab;
+    pool->bump     = (u8*)slab + header;
+    pool->bump_end = (u8*)slab + size;
+}
\ No newline at end of file
@@ -7,7 +7,7 @@
 #define QUEUE_INITIAL_LENGTH 256
 #define QUEUE_REALLOC_STEP   128
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 struct Queue {
     T*         data;
     u32        count;
@@ -16,61 +16,60 @@ struct Queue {
     u32        tail;
     Allocator* allocator;
 
-    Queue(u32 length = QUEUE_INITIAL_LENGTH, Allocator* allocator = &Allocator_Std) : count(0),
+    Queue(u32 length = QUEUE_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default()) : count(0),
                                                                                       length(length),
                                                                                       head(0),
                                                                                       tail(0),
                                                                                       allocator(allocator) {
-        data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+        data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
         Assert(data, "Cannot allocate memory for queue data.");
     }
 
     ~Queue() {
-        if (allocator == &Allocator_Temp) return;
-
-        allocator_free(allocator, data);
+        Alloc::free(allocator, data);
     }
 };
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 static inline
-Queue<T>*
-queue_make(u32 length = QUEUE_INITIAL_LENGTH, Allocator* allocator = &Allocator_Std);
+Queue<T, Alloc>*
+queue_make(u32 length = QUEUE_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default());
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_realloc(Queue<T>* queue, u32 length);
+queue_realloc(Queue<T, Alloc>* queue, u32 length);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_free(Queue<T>* queue);
+queue_free(Queue<T, Alloc>* queue);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_enqueue(Queue<T>* queue, T elem);
+queue_enqueue(Queue<T, Alloc>* queue, T elem);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-queue_dequeue(Queue<T>* queue);
+queue_dequeue(Queue<T, Alloc>* queue);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_clear(Queue<T>* queue);
+queue_clear(Queue<T, Alloc>* queue);
 
 // Implementation
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
-Queue<T>*
+Queue<T, Alloc>*
 queue_make(u32 length, Allocator* allocator) {
-    auto queue = (Queue<T>*)allocator_alloc(allocator, sizeof(Queue<T>));
+    ALLOCATOR_TAG("queue_make");
+    auto queue = (Queue<T, Alloc>*)Alloc::alloc(allocator, sizeof(Queue<T, Alloc>), alignof(Queue<T, Alloc>));
     Assert(queue, "Cannot allocate memory for queue.");
-    auto data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+    auto data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
     Assert(data, "Cannot allocate memory for queue data");
 
     queue->data      = data;
@@ -83,62 +82,44 @@ queue_make(u32 length, Allocator* allocator) {
     return queue;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_realloc(Queue<T>* queue, u32 length) {
+queue_realloc(Queue<T, Alloc>* queue, u32 length) {
+    ALLOCATOR_TAG("queue_realloc");
     Assert(length > queue->length, "Cannot resize queue with less size.");
-    if (queue->allocator == &Allocator_Temp) {
-        T* new_data = (T*)allocator_alloc(queue->allocator, sizeof(T) * length);
-        Assert(new_data, "Cannot allocate enough memory for new queue");
 
-        u32 head = queue->head;
-        u32 tail = queue->tail;
+    queue->data = (T*)Alloc::realloc(queue->allocator, queue->data, sizeof(T) * queue->length, sizeof(T) * length, alignof(T));
+    Assert(queue->data, "Cannot allocate enough memory for new queue");
 
-        queue->head = 0;
-        queue->tail = 0;
+    // Queue is wrapped around the end of the old data, move the front part after the old elements
+    if (queue->count > 0 && (queue->head > queue->tail || queue->head == queue->tail)) {
+        u32 start = queue->length;
+        u32 end   = queue->tail;
 
-        while (head != tail) {
-            new_data[queue->tail++] = queue->data[head];
-            head = (head + 1) % queue->length;
+        for (u32 i = 0; i < end; i++) {
+            u32 index = (start + i) % length;
+            queue->data[index] = queue->data[i];
         }
 
-        queue->data = new_data;
-    } else {
-        T* origin = queue->data;
-        queue->data = (T*)allocator_realloc(queue->allocator, queue->data, sizeof(T) * length);
-        Assert(queue->data, "Cannot allocate enough memory for new queue");
-
-        if (queue->head > queue->tail || queue->head == queue->tail) {
-            u32 start = queue->length;
-            u32 end   = queue->tail;
-
-            for (u32 i = 0; i < end; i++) {
-                u32 index = (start + i) % length;
-                queue->data[index] = origin[i];
-            }
-
-            queue->tail = (start + end) % length;
-        }
+        queue->tail = (start + end) % length;
     }
 
     queue->length = length;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_free(Queue<T>* queue) {
-    if (queue->allocator == &Allocator_Temp) return;
-
-    allocator_free(queue->allocator, queue->data);
-    allocator_free(queue->allocator, queue);
+queue_free(Queue<T, Alloc>* queue) {
+    Alloc::free(queue->allocator, queue->data);
+    Alloc::free(queue->allocator, queue);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_enqueue(Queue<T>* queue, T elem) {
+queue_enqueue(Queue<T, Alloc>* queue, T elem) {
     if (queue->count >= queue->length)
         queue_realloc(queue, queue->count + 1 + QUEUE_REALLOC_STEP);
 
@@ -148,10 +129,10 @@ queue_enqueue(Queue<T>* queue, T elem) {
     queue->data[index] = elem;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-queue_dequeue(Queue<T>* queue) {
+queue_dequeue(Queue<T, Alloc>* queue) {
     Assert(queue->count > 0, "Cannot dequeu if queue is empty.");
     T elem = queue->data[queue->head];
     queue->count--;
@@ -165,10 +146,10 @@ queue_dequeue(Queue<T>* queue) {
     return elem;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-queue_clear(Queue<T>* queue) {
+queue_clear(Queue<T, Alloc>* queue) {
     queue->head  = 0;
     queue->tail  = 0;
     queue->count = 0;
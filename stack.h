@@ -7,70 +7,69 @@
 #define STACK_INITIAL_LENGTH 256
 #define STACK_REALLOC_STEP   128
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 struct Stack {
     T*         data;
     u32        count;
     u32        length;
     Allocator* allocator;
 
-    Stack(u32 length = STACK_INITIAL_LENGTH, Allocator* allocator = &Allocator_Std) : count(0),
+    Stack(u32 length = STACK_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default()) : count(0),
                                                                                       length(length),
                                                                                       allocator(allocator) {
-        data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+        data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
         Assert(data, "Cannot allocate memory for stack data.");
     }
 
     ~Stack() {
-        if (allocator == &Allocator_Temp) return;
-
-        allocator_free(allocator, data);
+        Alloc::free(allocator, data);
     }
 };
 
-template <typename T>
+template <typename T, typename Alloc = Dynamic_Alloc>
 static inline
-Stack<T>*
-stack_make(u32 length = STACK_INITIAL_LENGTH, Allocator* allocator = &Allocator_Std);
+Stack<T, Alloc>*
+stack_make(u32 length = STACK_INITIAL_LENGTH, Allocator* allocator = Alloc::get_default());
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_realloc(Stack<T>* stack, u32 length);
+stack_realloc(Stack<T, Alloc>* stack, u32 length);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_free(Stack<T>* stack);
+stack_free(Stack<T, Alloc>* stack);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_push(Stack<T>* stack, T element);
+stack_push(Stack<T, Alloc>* stack, T element);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-stack_cuck(Stack<T>* stack);
+stack_cuck(Stack<T, Alloc>* stack);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-stack_pop(Stack<T>* stack);
+stack_pop(Stack<T, Alloc>* stack);
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_clear(Stack<T>* stack);
+stack_clear(Stack<T, Alloc>* stack);
 
 // Implementation
-template <typename T>
+template <typename T, typename Alloc>
 static inline
-Stack<T>*
+Stack<T, Alloc>*
 stack_make(u32 length, Allocator* allocator) {
-    auto stack = (Stack<T>*)allocator_alloc(allocator, sizeof(Stack<T>));
+    ALLOCATOR_TAG("stack_make");
+    auto stack = (Stack<T, Alloc>*)Alloc::alloc(allocator, sizeof(Stack<T, Alloc>), alignof(Stack<T, Alloc>));
     Assert(stack, "Cannot allocate memory for stack.");
-    auto data = (T*)allocator_alloc(allocator, sizeof(T) * length);
+    auto data = (T*)Alloc::alloc(allocator, sizeof(T) * length, alignof(T));
     Assert(data, "Cannot allocate memory for stack data.");
 
     stack->data      = data;
@@ -81,40 +80,30 @@ stack_make(u32 length, Allocator* allocator) {
     return stack;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_realloc(Stack<T>* stack, u32 length) {
+stack_realloc(Stack<T, Alloc>* stack, u32 length) {
+    ALLOCATOR_TAG("stack_realloc");
     Assert(length > stack->length, "Cannot resize stack with less size.");
-    if (stack->allocator == &Allocator_Temp) {
-        T* new_data = (T*)allocator_alloc(stack->allocator, sizeof(T) * length);
-        Assert(new_data, "Cannot allocate enough memory for new stack");
-
-        for (u32 i = 0; i < stack->count; i++) {
-            new_data[i] = stack->data[i];
-        }
-
-        stack->data = new_data;
-    } else {
-        stack->data = (T*)allocator_realloc(stack->allocator, stack->data, sizeof(T) * length);
-    }
 
+    stack->data = (T*)Alloc::realloc(stack->allocator, stack->data, sizeof(T) * stack->length, sizeof(T) * length, alignof(T));
     Assert(stack->data, "Cannot allocate enough memory for new stack");
     stack->length = length;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_free(Stack<T>* stack) {
-    allocator_free(stack->allocator, stack->data);
-    allocator_free(stack->allocator, stack);
+stack_free(Stack<T, Alloc>* stack) {
+    Alloc::free(stack->allocator, stack->data);
+    Alloc::free(stack->allocator, stack);
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_push(Stack<T>* stack, T element) {
+stack_push(Stack<T, Alloc>* stack, T element) {
     if (stack->count >= stack->length) {
         stack_realloc(stack, stack->count + 1 + STACK_REALLOC_STEP);
     }
@@ -122,25 +111,25 @@ stack_push(Stack<T>* stack, T element) {
     stack->data[stack->count++] = element;
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-stack_cuck(Stack<T>* stack) {
+stack_cuck(Stack<T, Alloc>* stack) {
     Assert(stack->count > 0, "You are trying to cuck element, but stack is empty");
     return stack->data[stack->count - 1];
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 T
-stack_pop(Stack<T>* stack) {
+stack_pop(Stack<T, Alloc>* stack) {
     Assert(stack->count > 0, "You are trying to pop element, but stack is empty");
     return stack->data[--stack->count];
 }
 
-template <typename T>
+template <typename T, typename Alloc>
 static inline
 void
-stack_clear(Stack<T>* stack) {
+stack_clear(Stack<T, Alloc>* stack) {
     stack->count = 0;
 }
\ No newline at end of file
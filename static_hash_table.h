@@ -0,0 +1,221 @@
+#pragma once
+
+#include "basic.h"
+#include "assert.h"
+#include "hash_functions.h"
+
+#define STATIC_HASH_TABLE_LOAD_FACTOR 50  // length is the power of 2 at least count * 100 / 50
+#define STATIC_HASH_TABLE_MULTIPLIERS 256 // tried by the builder, the first one without collisions is taken
+
+/*
+    Static_Hash_Table is built at compile time from a fixed set of keys and lives in a static constexpr
+    variable, no allocation and no initialization at startup:
+
+        static constexpr auto opcodes = static_hash_table_make<const char*, u8, String_Hash, String_Equal>({
+            { "add", OP_ADD },
+            { "sub", OP_SUB },
+        });
+
+        u8 op = static_hash_table_get(&opcodes, name);
+
+    The slot is the top bits of hash * multiplier. The builder tries multipliers until no two keys share a slot,
+    then a lookup is one hash, one multiply, one compare. If every multiplier collides, the best one is kept and
+    lookups probe the next max_probe slots. Hash and Equal must be constexpr, like the ones in hash_functions.h.
+*/
+template <typename Key, typename Value>
+struct Static_Hash_Table_Entry {
+    Key   key;
+    Value value;
+};
+
+static inline constexpr
+u32
+static_hash_table_length(u32 count) {
+    u32 length = 2;
+
+    while ((u64)length * STATIC_HASH_TABLE_LOAD_FACTOR < (u64)count * 100) length *= 2;
+
+    return length;
+}
+
+static inline constexpr
+u32
+static_hash_table_shift(u32 length) {
+    u32 shift = 64;
+
+    while (length > 1) {
+        length /= 2;
+        shift--;
+    }
+
+    return shift;
+}
+
+template <typename Key, typename Value, u32 Count, typename Hash = Default_Hash, typename Equal = Default_Equal>
+struct Static_Hash_Table {
+    static constexpr u32 LENGTH = static_hash_table_length(Count);
+    static constexpr u32 SHIFT  = static_hash_table_shift(LENGTH);
+
+    u64                                 multiplier = 0;
+    u32                                 max_probe  = 0; // 1 if no keys collide
+    bool                                filled[LENGTH]  = {};
+    Static_Hash_Table_Entry<Key, Value> entries[LENGTH] = {};
+};
+
+template <typename Key, typename Value, typename Hash = Default_Hash, typename Equal = Default_Equal, u32 Count>
+static inline constexpr
+Static_Hash_Table<Key, Value, Count, Hash, Equal>
+static_hash_table_make(const Static_Hash_Table_Entry<Key, Value> (&entries)[Count]); // Keys must be unique, a duplicate fails the compilation.
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+const Value*
+static_hash_table_get_ptr(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key); // Returns pointer to the value or null.
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+Value
+static_hash_table_get(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key);
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+bool
+static_hash_table_try_get(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key, Value* value);
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+bool
+static_hash_table_contains(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key);
+
+template <u32 Length>
+static inline constexpr
+u32
+static_hash_table_max_probe(const u64* hashes, u32 count, u64 multiplier); // Longest linear probe of the keys with the multiplier.
+
+static inline
+void
+static_hash_table_duplicate_key(); // Not constexpr, so calling it at compile time is an error.
+
+// Implementation
+template <typename Key, typename Value, typename Hash, typename Equal, u32 Count>
+static inline constexpr
+Static_Hash_Table<Key, Value, Count, Hash, Equal>
+static_hash_table_make(const Static_Hash_Table_Entry<Key, Value> (&entries)[Count]) {
+    using Table = Static_Hash_Table<Key, Value, Count, Hash, Equal>;
+
+    Table table;
+    u64   hashes[Count] = {};
+
+    for (u32 i = 0; i < Count; i++) {
+        hashes[i] = Hash::hash(entries[i].key);
+
+        for (u32 j = 0; j < i; j++) {
+            if (hashes[i] == hashes[j] && Equal::equal(entries[i].key, entries[j].key)) {
+                static_hash_table_duplicate_key();
+            }
+        }
+    }
+
+    table.max_probe = 0xFFFFFFFF;
+
+    for (u32 i = 1; i <= STATIC_HASH_TABLE_MULTIPLIERS && table.max_probe > 1; i++) {
+        u64 multiplier = hash_u64(i) | 1;
+        u32 max_probe  = static_hash_table_max_probe<Table::LENGTH>(hashes, Count, multiplier);
+
+        if (max_probe < table.max_probe) {
+            table.multiplier = multiplier;
+            table.max_probe  = max_probe;
+        }
+    }
+
+    for (u32 i = 0; i < Count; i++) {
+        u32 slot = (u32)((hashes[i] * table.multiplier) >> Table::SHIFT);
+
+        while (table.filled[slot]) slot = (slot + 1) & (Table::LENGTH - 1);
+
+        table.filled[slot]  = true;
+        table.entries[slot] = entries[i];
+    }
+
+    return table;
+}
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+const Value*
+static_hash_table_get_ptr(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key) {
+    using Table = Static_Hash_Table<Key, Value, Count, Hash, Equal>;
+
+    u32 slot = (u32)((Hash::hash(key) * table->multiplier) >> Table::SHIFT);
+
+    for (u32 i = 0; i < table->max_probe; i++) {
+        if (table->filled[slot] && Equal::equal(table->entries[slot].key, key)) {
+            return &table->entries[slot].value;
+        }
+
+        slot = (slot + 1) & (Table::LENGTH - 1);
+    }
+
+    return null;
+}
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+Value
+static_hash_table_get(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key) {
+    const Value* ptr = static_hash_table_get_ptr(table, key);
+    Assert(ptr, "The key was not presented in the static hash table.");
+
+    return *ptr;
+}
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+bool
+static_hash_table_try_get(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key, Value* value) {
+    const Value* ptr = static_hash_table_get_ptr(table, key);
+
+    if (!ptr) {
+        return false;
+    }
+
+    *value = *ptr;
+
+    return true;
+}
+
+template <typename Key, typename Value, u32 Count, typename Hash, typename Equal>
+static inline constexpr
+bool
+static_hash_table_contains(const Static_Hash_Table<Key, Value, Count, Hash, Equal>* table, Key key) {
+    return static_hash_table_get_ptr(table, key) != null;
+}
+
+template <u32 Length>
+static inline constexpr
+u32
+static_hash_table_max_probe(const u64* hashes, u32 count, u64 multiplier) {
+    bool filled[Length] = {};
+    u32  max_probe      = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        u32 slot  = (u32)((hashes[i] * multiplier) >> static_hash_table_shift(Length));
+        u32 probe = 1;
+
+        while (filled[slot]) {
+            slot = (slot + 1) & (Length - 1);
+            probe++;
+        }
+
+        filled[slot] = true;
+        if (probe > max_probe) max_probe = probe;
+    }
+
+    return max_probe;
+}
+
+static inline
+void
+static_hash_table_duplicate_key() {
+    Assert(false, "An item with the same key has already been added.");
+}
\ No newline at end of file
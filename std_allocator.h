@@ -3,6 +3,7 @@
 #include "basic.h"
 #include "allocator.h"
 #include <malloc.h>
+#include <stdlib.h>
 
 static inline
 void*
@@ -10,6 +11,15 @@ std_alloc(Allocator* allocator, u64 size) {
     return malloc(size);
 }
 
+static inline
+void*
+std_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    if (alignment <= ALLOCATOR_DEFAULT_ALIGNMENT) return malloc(size);
+
+    // aligned_alloc wants size to be a multiple of alignment
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
 static inline
 void*
 std_realloc(Allocator* allocator, void* ptr, u64 size) {
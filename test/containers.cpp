@@ -0,0 +1,462 @@
+/*
+    Behaviour checks of the containers against std:: references.
+
+        g++ -std=c++20 -DDEBUG -g -O1 -fsanitize=address,undefined -I.. containers.cpp -o containers
+        ./containers
+
+    DEBUG turns the Asserts of the containers on. Prints every failed check and returns 1 if there was one.
+*/
+#include "../basic.h"
+#include "../hash_table.h"
+#include "../hash_set.h"
+#include "../dict.h"
+#include "../perfect_hash_table.h"
+#include "../static_hash_table.h"
+#include "../bloom_filter.h"
+#include "../cuckoo_filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define TEST_KEYS 20000 // key space of the random operations, small enough to hit the same keys again
+
+#define TEST_CHECK(expr) \
+    if (!(expr)) {\
+        printf("%s:%i: check failed: %s\n", __FILE__, __LINE__, #expr);\
+        test_failures++;\
+    }\
+
+static u32 test_failures;
+static u64 test_state = 1;
+
+// every key goes to one of 8 home groups, so probe sequences run through many full groups
+struct Test_Clustered_Hash {
+    static inline
+    u64
+    hash(u64 key) {
+        return (hash_u64(key) & 0x7F) | ((key % 8) << 7);
+    }
+};
+
+static inline
+u64
+test_random() {
+    test_state = hash_u64(test_state);
+    return test_state;
+}
+
+static inline
+void
+test_compare(Hash_Table<u64, u64>* table, std::unordered_map<u64, u64>& reference) {
+    TEST_CHECK(table->count == reference.size());
+
+    for (auto& [key, value] : reference) {
+        u64 got = 0;
+        TEST_CHECK(hash_table_try_get(table, key, &got) && got == value);
+    }
+
+    for (u64 key = TEST_KEYS; key < TEST_KEYS + 1000; key++) {
+        TEST_CHECK(!hash_table_contains(table, key));
+    }
+}
+
+static inline
+void
+test_hash_table(u32 flags) {
+    auto                         table = hash_table_make<u64, u64>(16, Dynamic_Alloc::get_default(), alignof(u64), flags);
+    std::unordered_map<u64, u64> reference;
+
+    // random churn, removes leave deleted slots and the table grows, rehashes or migrates in between
+    for (u32 i = 0; i < 200000; i++) {
+        u64 key   = test_random() % TEST_KEYS;
+        u64 value = test_random();
+
+        switch (test_random() % 6) {
+            case 0:
+                if (!reference.count(key)) {
+                    hash_table_add(table, key, value);
+                    reference[key] = value;
+                }
+                break;
+            case 1:
+                TEST_CHECK(hash_table_add_or_set(table, key, value) == (reference.count(key) != 0));
+                reference[key] = value;
+                break;
+            case 2:
+                TEST_CHECK(hash_table_remove_if_contains(table, key) == (reference.erase(key) != 0));
+                break;
+            case 3: {
+                bool inserted;
+                u64* ptr       = hash_table_find_or_insert(table, key, &inserted);
+                bool contained = reference.count(key) != 0;
+
+                TEST_CHECK(ptr && inserted == !contained);
+                if (ptr) *ptr += 1;
+                reference[key] += 1;
+                break;
+            }
+            case 4: {
+                u64* ptr = hash_table_get_ptr(table, key);
+
+                TEST_CHECK((ptr != null) == (reference.count(key) != 0));
+                if (ptr) *ptr = reference[key] = value;
+                break;
+            }
+            case 5: {
+                u64  got;
+                bool found = hash_table_try_get(table, key, &got);
+
+                TEST_CHECK(found == (reference.count(key) != 0));
+                if (found) TEST_CHECK(got == reference[key]);
+                break;
+            }
+        }
+
+        if (i % 10000 == 0) test_compare(table, reference);
+    }
+
+    test_compare(table, reference);
+
+    // batches of new keys, then lookups of a mix of present and missing keys
+    std::vector<u64> keys;
+    std::vector<u64> values;
+
+    for (u64 key = TEST_KEYS * 2; key < TEST_KEYS * 2 + 5000; key++) {
+        keys.push_back(key);
+        values.push_back(key * 3);
+        reference[key] = key * 3;
+    }
+
+    hash_table_add_many(table, keys.data(), values.data(), (u32)keys.size());
+    test_compare(table, reference);
+
+    std::vector<u64> queries;
+    for (u32 i = 0; i < 10000; i++) queries.push_back(i % 2 ? TEST_KEYS * 2 + test_random() % 10000 : test_random() % TEST_KEYS);
+
+    std::vector<u64> got(queries.size());
+    bool*            found = (bool*)malloc(queries.size());
+    u32              hits  = 0;
+
+    for (u64 key : queries) hits += reference.count(key) != 0;
+
+    TEST_CHECK(hash_table_contains_many(table, queries.data(), (u32)queries.size(), found) == hits);
+    for (u32 i = 0; i < queries.size(); i++) TEST_CHECK(found[i] == (reference.count(queries[i]) != 0));
+
+    TEST_CHECK(hash_table_get_many(table, queries.data(), (u32)queries.size(), got.data(), found) == hits);
+    for (u32 i = 0; i < queries.size(); i++) {
+        if (found[i]) TEST_CHECK(got[i] == reference[queries[i]]);
+    }
+
+    free(found);
+    hash_table_free(table);
+}
+
+static inline
+void
+test_hash_table_migration() {
+    auto table = hash_table_make<u64, u64, Dynamic_Alloc, Test_Clustered_Hash>(HASH_TABLE_INITIAL_LENGTH, Dynamic_Alloc::get_default(), alignof(u64), HASH_TABLE_INCREMENTAL);
+    u64  count = 0;
+
+    while (!table->old_control) {
+        hash_table_add(table, count, count);
+        count++;
+    }
+
+    u64 old_key = count;
+    for (u64 key = 0; key < count && old_key == count; key++) {
+        if (hash_table_find(table, key, Test_Clustered_Hash::hash(key)) == HASH_TABLE_NOT_FOUND) old_key = key;
+    }
+
+    TEST_CHECK(old_key != count);
+
+    // removes of other keys migrate the old groups and free the old arrays at the end, the pointer must survive it
+    u64* ptr = hash_table_get_ptr(table, old_key);
+
+    for (u64 key = 0; key < count && table->old_control; key += 2) {
+        if (key != old_key) hash_table_remove(table, key);
+
+        // the keys that are not migrated yet are found through the groups that are
+        for (u64 other = 1; other < count; other += 2) TEST_CHECK(hash_table_contains(table, other));
+    }
+
+    TEST_CHECK(!table->old_control);
+    TEST_CHECK(ptr != null);
+
+    if (ptr) {
+        *ptr = 12345;
+        TEST_CHECK(hash_table_get(table, old_key) == 12345);
+    }
+
+    hash_table_free(table);
+}
+
+static inline
+Hash_Set<u64>*
+test_hash_set_make(const std::set<u64>& keys) {
+    auto set = hash_set_make<u64>(16);
+    for (u64 key : keys) hash_set_add(set, key);
+
+    return set;
+}
+
+static inline
+void
+test_hash_set_compare(Hash_Set<u64>* set, const std::set<u64>& reference) {
+    TEST_CHECK(set->count == reference.size());
+
+    for (u64 key = 0; key < TEST_KEYS; key++) {
+        TEST_CHECK(hash_set_contains(set, key) == (reference.count(key) != 0));
+    }
+}
+
+static inline
+void
+test_hash_set() {
+    std::set<u64> a;
+    std::set<u64> b;
+
+    for (u32 i = 0; i < 8000; i++) a.insert(test_random() % TEST_KEYS);
+    for (u32 i = 0; i < 8000; i++) b.insert(test_random() % TEST_KEYS);
+
+    auto set = test_hash_set_make(a);
+    test_hash_set_compare(set, a);
+
+    // a key is added once
+    TEST_CHECK(!hash_set_add(set, *a.begin()));
+
+    std::set<u64> expected;
+    auto          other = test_hash_set_make(b);
+
+    hash_set_union(set, other);
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+    test_hash_set_compare(set, expected);
+    hash_set_free(set);
+
+    set = test_hash_set_make(a);
+    expected.clear();
+
+    hash_set_intersection(set, other);
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+    test_hash_set_compare(set, expected);
+    hash_set_free(set);
+
+    set = test_hash_set_make(a);
+    expected.clear();
+
+    hash_set_difference(set, other);
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+    test_hash_set_compare(set, expected);
+
+    for (u64 key : std::set<u64>(expected)) {
+        if (key % 3) continue;
+
+        TEST_CHECK(hash_set_remove(set, key));
+        expected.erase(key);
+    }
+
+    test_hash_set_compare(set, expected);
+
+    hash_set_free(set);
+    hash_set_free(other);
+}
+
+static inline
+void
+test_dict() {
+    auto                             dict = dict_make<u64, u64>();
+    std::vector<std::pair<u64, u64>> reference; // in insertion order
+
+    for (u32 i = 0; i < 100000; i++) {
+        u64  key   = test_random() % 5000;
+        u64  value = test_random();
+        auto entry = std::find_if(reference.begin(), reference.end(), [&](auto& pair) { return pair.first == key; });
+
+        if (test_random() % 3 == 0) {
+            TEST_CHECK(dict_remove_if_contains(dict, key) == (entry != reference.end()));
+            if (entry != reference.end()) reference.erase(entry);
+        } else {
+            // set keeps the position of the key
+            TEST_CHECK(dict_add_or_set(dict, key, value) == (entry != reference.end()));
+
+            if (entry != reference.end()) {
+                entry->second = value;
+            } else {
+                reference.push_back({ key, value });
+            }
+        }
+
+        if (i % 10000 != 0) continue;
+
+        TEST_CHECK(dict->count == reference.size());
+
+        u32 position = 0;
+        for (auto& dict_entry : *dict) {
+            bool same = position < reference.size() && dict_entry.key == reference[position].first && dict_entry.value == reference[position].second;
+            TEST_CHECK(same);
+            position++;
+        }
+
+        TEST_CHECK(position == reference.size());
+    }
+
+    for (auto& [key, value] : reference) TEST_CHECK(dict_get(dict, key) == value);
+
+    dict_free(dict);
+}
+
+static inline
+void
+test_perfect_hash_table() {
+    std::vector<u64> keys;
+    std::vector<u64> values;
+    std::set<u64>    unique;
+
+    while (unique.size() < 10000) unique.insert(test_random());
+
+    for (u64 key : unique) {
+        keys.push_back(key);
+        values.push_back(key ^ 0xABCD);
+    }
+
+    auto table = perfect_hash_table_build<u64, u64>(keys.data(), values.data(), (u32)keys.size());
+    TEST_CHECK(table != null);
+    if (!table) return;
+
+    const char* path = "containers_test.pht";
+    TEST_CHECK(perfect_hash_table_save(table, path));
+
+    auto opened = perfect_hash_table_open<u64, u64>(path);
+    TEST_CHECK(opened != null);
+
+    for (u32 i = 0; i < keys.size() && opened; i++) {
+        u64 value;
+        TEST_CHECK(perfect_hash_table_try_get(table, keys[i], &value) && value == values[i]);
+        TEST_CHECK(perfect_hash_table_try_get(opened, keys[i], &value) && value == values[i]);
+    }
+
+    for (u32 i = 0; i < 10000 && opened; i++) {
+        u64 key = test_random();
+        TEST_CHECK(perfect_hash_table_contains(opened, key) == (unique.count(key) != 0));
+    }
+
+    // a block of another size or another type is not a table
+    TEST_CHECK(!(perfect_hash_table_view<u64, u64>(table->header, table->header->size - 1)));
+    TEST_CHECK(!(perfect_hash_table_view<u64, u32>(table->header, table->header->size)));
+
+    if (opened) perfect_hash_table_free(opened);
+    perfect_hash_table_free(table);
+    remove(path);
+
+    // a repeated key
+    keys[1] = keys[0];
+    TEST_CHECK(!(perfect_hash_table_build<u64, u64>(keys.data(), values.data(), (u32)keys.size())));
+}
+
+static inline
+void
+test_filters() {
+    std::vector<u64> keys;
+    std::set<u64>    unique;
+
+    while (unique.size() < 10000) unique.insert(test_random());
+    keys.assign(unique.begin(), unique.end());
+
+    auto bloom  = bloom_filter_make<u64>((u32)keys.size());
+    auto cuckoo = cuckoo_filter_make<u64>((u32)keys.size());
+
+    for (u32 i = 0; i < keys.size() / 2; i++) {
+        bloom_filter_add(bloom, keys[i]);
+        TEST_CHECK(cuckoo_filter_add(cuckoo, keys[i]));
+    }
+
+    u32 half = (u32)(keys.size() - keys.size() / 2);
+
+    bloom_filter_add_many(bloom, &keys[keys.size() / 2], half);
+    TEST_CHECK(cuckoo_filter_add_many(cuckoo, &keys[keys.size() / 2], half) == half);
+
+    // no false negatives
+    bool* found = (bool*)malloc(keys.size());
+
+    for (u64 key : keys) {
+        TEST_CHECK(bloom_filter_contains(bloom, key));
+        TEST_CHECK(cuckoo_filter_contains(cuckoo, key));
+    }
+
+    TEST_CHECK(bloom_filter_contains_many(bloom, keys.data(), (u32)keys.size(), found) == keys.size());
+    TEST_CHECK(cuckoo_filter_contains_many(cuckoo, keys.data(), (u32)keys.size(), found) == keys.size());
+
+    // false positives near the rate they were made for, with plenty of room for chance
+    u32 bloom_positives  = 0;
+    u32 cuckoo_positives = 0;
+    u32 tries            = 0;
+
+    while (tries < 100000) {
+        u64 key = test_random();
+        if (unique.count(key)) continue;
+
+        bloom_positives  += bloom_filter_contains(bloom, key);
+        cuckoo_positives += cuckoo_filter_contains(cuckoo, key);
+        tries++;
+    }
+
+    TEST_CHECK(bloom_positives < tries * BLOOM_FILTER_FALSE_POSITIVE_RATE * 3);
+    TEST_CHECK(cuckoo_positives < tries * CUCKOO_FILTER_FALSE_POSITIVE_RATE * 3);
+
+    // removed keys leave the others in place
+    for (u32 i = 0; i < keys.size(); i += 2) TEST_CHECK(cuckoo_filter_remove(cuckoo, keys[i]));
+    for (u32 i = 1; i < keys.size(); i += 2) TEST_CHECK(cuckoo_filter_contains(cuckoo, keys[i]));
+
+    free(found);
+    bloom_filter_free(bloom);
+    cuckoo_filter_free(cuckoo);
+}
+
+static constexpr auto test_opcodes = static_hash_table_make<const char*, u32, String_Hash, String_Equal>({
+    { "add", 1 },
+    { "sub", 2 },
+    { "mul", 3 },
+    { "div", 4 },
+    { "mov", 5 },
+    { "jmp", 6 },
+});
+
+static_assert(static_hash_table_get(&test_opcodes, "mul") == 3);
+static_assert(static_hash_table_get(&test_opcodes, "jmp") == 6);
+static_assert(!static_hash_table_contains(&test_opcodes, "nop"));
+
+static inline
+void
+test_static_hash_table() {
+    // not constant folded, the keys are other pointers with the same text
+    char name[4] = { 's', 'u', 'b', 0 };
+
+    TEST_CHECK(static_hash_table_get(&test_opcodes, (const char*)name) == 2);
+
+    name[0] = 'x';
+    TEST_CHECK(!static_hash_table_contains(&test_opcodes, (const char*)name));
+}
+
+int
+main() {
+    test_hash_table(0);
+    test_hash_table(HASH_TABLE_INCREMENTAL);
+    test_hash_table_migration();
+    test_hash_set();
+    test_dict();
+    test_perfect_hash_table();
+    test_filters();
+    test_static_hash_table();
+
+    if (test_failures) {
+        printf("%u checks failed\n", test_failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,452 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <memory.h>
+
+#define TLSF_ALIGNMENT        ALLOCATOR_DEFAULT_ALIGNMENT
+#define TLSF_SL_INDEX_LOG2    5
+#define TLSF_SL_INDEX_COUNT   (1 << TLSF_SL_INDEX_LOG2)
+#define TLSF_FL_INDEX_SHIFT   (TLSF_SL_INDEX_LOG2 + 4) // 4 = log2(TLSF_ALIGNMENT)
+#define TLSF_FL_INDEX_MAX     38                       // blocks up to 256GB
+#define TLSF_FL_INDEX_COUNT   (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+#define TLSF_SMALL_BLOCK_SIZE (1 << TLSF_FL_INDEX_SHIFT)
+#define TLSF_BLOCK_HEADER     16
+#define TLSF_BLOCK_MIN        16
+#define TLSF_BLOCK_MAX        (1ull << TLSF_FL_INDEX_MAX)
+#define TLSF_BLOCK_FREE       1
+
+/*
+    Two-level segregated fit allocator. It manages a region of memory given by the caller,
+    free blocks are kept in TLSF_FL_INDEX_COUNT * TLSF_SL_INDEX_COUNT size classes and two levels of bitmaps
+    find a non-empty class with a couple of bit scans, so alloc and free are O(1) in the worst case.
+    Free blocks are merged with their neighbours immediately, which keeps fragmentation low.
+    Not thread safe, make one per thread.
+*/
+struct Tlsf_Block {
+    Tlsf_Block* prev_physical;
+    u64         size;      // size of the payload, the lowest bit is set when the block is free
+    // the payload starts here, free blocks keep the free list links in it
+    Tlsf_Block* next_free;
+    Tlsf_Block* prev_free;
+};
+
+struct Tlsf {
+    u32         fl_bitmap;
+    u32         sl_bitmap[TLSF_FL_INDEX_COUNT];
+    Tlsf_Block* blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];
+};
+
+static inline
+Tlsf*
+tlsf_make(void* memory, u64 size); // The control structure is placed at the start of the memory, the rest is used for blocks.
+
+static inline
+void
+tlsf_add_region(Tlsf* tlsf, void* memory, u64 size);
+
+static inline
+void*
+tlsf_get(Tlsf* tlsf, u64 size, u64 alignment = TLSF_ALIGNMENT);
+
+static inline
+void*
+tlsf_resize(Tlsf* tlsf, void* ptr, u64 size);
+
+static inline
+void
+tlsf_put(Tlsf* tlsf, void* ptr);
+
+static inline
+Allocator
+tlsf_allocator_make(Tlsf* tlsf);
+
+static inline
+void*
+tlsf_alloc(Allocator* allocator, u64 size);
+
+static inline
+void*
+tlsf_alloc_aligned(Allocator* allocator, u64 size, u64 alignment);
+
+static inline
+void*
+tlsf_realloc(Allocator* allocator, void* ptr, u64 size);
+
+static inline
+void
+tlsf_free(Allocator* allocator, void* ptr);
+
+// Implementation
+static inline
+u64
+tlsf_block_size(Tlsf_Block* block) {
+    return block->size & ~(u64)TLSF_BLOCK_FREE;
+}
+
+static inline
+bool
+tlsf_block_is_free(Tlsf_Block* block) {
+    return block->size & TLSF_BLOCK_FREE;
+}
+
+static inline
+Tlsf_Block*
+tlsf_block_next(Tlsf_Block* block) {
+    return (Tlsf_Block*)((u8*)block + TLSF_BLOCK_HEADER + tlsf_block_size(block));
+}
+
+static inline
+Tlsf_Block*
+tlsf_block_from_ptr(void* ptr) {
+    return (Tlsf_Block*)((u8*)ptr - TLSF_BLOCK_HEADER);
+}
+
+static inline
+void*
+tlsf_block_to_ptr(Tlsf_Block* block) {
+    return (u8*)block + TLSF_BLOCK_HEADER;
+}
+
+static inline
+u64
+tlsf_align_up(u64 value, u64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static inline
+void
+tlsf_mapping_insert(u64 size, u32* fl, u32* sl) {
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = (u32)size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT);
+    } else {
+        u32 msb = 63 - __builtin_clzll(size);
+        *sl = (u32)(size >> (msb - TLSF_SL_INDEX_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+        *fl = msb - (TLSF_FL_INDEX_SHIFT - 1);
+    }
+}
+
+// Same as insert, but rounds the size up to the next class, so any block of the class fits.
+static inline
+void
+tlsf_mapping_search(u64 size, u32* fl, u32* sl) {
+    if (size >= TLSF_SMALL_BLOCK_SIZE) {
+        u32 msb = 63 - __builtin_clzll(size);
+        size += (1ull << (msb - TLSF_SL_INDEX_LOG2)) - 1;
+    }
+
+    tlsf_mapping_insert(size, fl, sl);
+}
+
+static inline
+void
+tlsf_insert_free(Tlsf* tlsf, Tlsf_Block* block) {
+    u32 fl, sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+
+    Tlsf_Block* current = tlsf->blocks[fl][sl];
+
+    block->next_free = current;
+    block->prev_free = null;
+
+    if (current) current->prev_free = block;
+
+    tlsf->blocks[fl][sl]  = block;
+    tlsf->fl_bitmap      |= 1u << fl;
+    tlsf->sl_bitmap[fl]  |= 1u << sl;
+}
+
+static inline
+void
+tlsf_remove_free(Tlsf* tlsf, Tlsf_Block* block) {
+    u32 fl, sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+
+    Tlsf_Block* prev = block->prev_free;
+    Tlsf_Block* next = block->next_free;
+
+    if (next) next->prev_free = prev;
+
+    if (prev) {
+        prev->next_free = next;
+    } else {
+        tlsf->blocks[fl][sl] = next;
+
+        if (!next) {
+            tlsf->sl_bitmap[fl] &= ~(1u << sl);
+
+            if (!tlsf->sl_bitmap[fl]) tlsf->fl_bitmap &= ~(1u << fl);
+        }
+    }
+}
+
+// Finds a free block that fits size and removes it from the free lists.
+static inline
+Tlsf_Block*
+tlsf_locate_free(Tlsf* tlsf, u64 size) {
+    u32 fl, sl;
+    tlsf_mapping_search(size, &fl, &sl);
+
+    if (fl >= TLSF_FL_INDEX_COUNT) return null;
+
+    u32 sl_map = tlsf->sl_bitmap[fl] & (~0u << sl);
+
+    if (!sl_map) {
+        u32 fl_map = fl + 1 < 32 ? tlsf->fl_bitmap & (~0u << (fl + 1)) : 0;
+
+        if (!fl_map) return null;
+
+        fl     = __builtin_ctz(fl_map);
+        sl_map = tlsf->sl_bitmap[fl];
+    }
+
+    sl = __builtin_ctz(sl_map);
+
+    Tlsf_Block* block = tlsf->blocks[fl][sl];
+    tlsf_remove_free(tlsf, block);
+
+    return block;
+}
+
+static inline
+bool
+tlsf_can_split(Tlsf_Block* block, u64 size) {
+    return tlsf_block_size(block) >= size + TLSF_BLOCK_HEADER + TLSF_BLOCK_MIN;
+}
+
+// Cuts the block to size and returns the rest as a new block, the rest is marked as used.
+static inline
+Tlsf_Block*
+tlsf_split(Tlsf_Block* block, u64 size) {
+    Tlsf_Block* rest = (Tlsf_Block*)((u8*)block + TLSF_BLOCK_HEADER + size);
+
+    rest->size          = tlsf_block_size(block) - size - TLSF_BLOCK_HEADER;
+    rest->prev_physical = block;
+    block->size         = size | (block->size & TLSF_BLOCK_FREE);
+
+    tlsf_block_next(rest)->prev_physical = rest;
+
+    return rest;
+}
+
+// Absorbs the next physical block into the block.
+static inline
+void
+tlsf_merge(Tlsf_Block* block, Tlsf_Block* next) {
+    block->size += tlsf_block_size(next) + TLSF_BLOCK_HEADER;
+
+    tlsf_block_next(block)->prev_physical = block;
+}
+
+// Gives the tail of a used block back to the free lists.
+static inline
+void
+tlsf_trim(Tlsf* tlsf, Tlsf_Block* block, u64 size) {
+    if (!tlsf_can_split(block, size)) return;
+
+    Tlsf_Block* rest = tlsf_split(block, size);
+    Tlsf_Block* next = tlsf_block_next(rest);
+
+    if (tlsf_block_is_free(next)) {
+        tlsf_remove_free(tlsf, next);
+        tlsf_merge(rest, next);
+    }
+
+    rest->size |= TLSF_BLOCK_FREE;
+    tlsf_insert_free(tlsf, rest);
+}
+
+static inline
+u64
+tlsf_adjust_size(u64 size) {
+    size = tlsf_align_up(size, TLSF_ALIGNMENT);
+
+    return size < TLSF_BLOCK_MIN ? TLSF_BLOCK_MIN : size;
+}
+
+static inline
+Tlsf*
+tlsf_make(void* memory, u64 size) {
+    u8* start = (u8*)tlsf_align_up((u64)memory, TLSF_ALIGNMENT);
+    u64 used  = (start - (u8*)memory) + tlsf_align_up(sizeof(Tlsf), TLSF_ALIGNMENT);
+    Assert(size > used, "Not enough memory for tlsf control structure.");
+
+    Tlsf* tlsf = (Tlsf*)start;
+    memset(tlsf, 0, sizeof(Tlsf));
+
+    tlsf_add_region(tlsf, (u8*)memory + used, size - used);
+
+    return tlsf;
+}
+
+static inline
+void
+tlsf_add_region(Tlsf* tlsf, void* memory, u64 size) {
+    u8* start     = (u8*)tlsf_align_up((u64)memory, TLSF_ALIGNMENT);
+    u64 available = (size - (start - (u8*)memory)) & ~(u64)(TLSF_ALIGNMENT - 1);
+    Assert(size > (u64)(start - (u8*)memory) && available >= 2 * TLSF_BLOCK_HEADER + TLSF_BLOCK_MIN, "Tlsf region is too small.");
+    Assert(available - 2 * TLSF_BLOCK_HEADER < TLSF_BLOCK_MAX, "Tlsf region is too big.");
+
+    // one free block for the whole region and a used sentinel of zero size after it,
+    // so blocks are never merged across the region bounds
+    Tlsf_Block* block   = (Tlsf_Block*)start;
+    block->prev_physical = null;
+    block->size          = (available - 2 * TLSF_BLOCK_HEADER) | TLSF_BLOCK_FREE;
+
+    Tlsf_Block* sentinel    = tlsf_block_next(block);
+    sentinel->prev_physical = block;
+    sentinel->size          = 0;
+
+    tlsf_insert_free(tlsf, block);
+}
+
+static inline
+void*
+tlsf_get(Tlsf* tlsf, u64 size, u64 alignment) {
+    Assert((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2.");
+    if (size >= TLSF_BLOCK_MAX) return null;
+
+    size = tlsf_adjust_size(size);
+
+    if (alignment <= TLSF_ALIGNMENT) {
+        Tlsf_Block* block = tlsf_locate_free(tlsf, size);
+
+        if (!block) return null;
+
+        block->size &= ~(u64)TLSF_BLOCK_FREE;
+        tlsf_trim(tlsf, block, size);
+
+        return tlsf_block_to_ptr(block);
+    }
+
+    // Take a block big enough to cut a free block in front of the aligned pointer.
+    u64         gap_min = TLSF_BLOCK_HEADER + TLSF_BLOCK_MIN;
+    Tlsf_Block* block   = tlsf_locate_free(tlsf, size + alignment + gap_min);
+
+    if (!block) return null;
+
+    u64 ptr     = (u64)tlsf_block_to_ptr(block);
+    u64 aligned = tlsf_align_up(ptr, alignment);
+
+    if (aligned != ptr && aligned - ptr < gap_min) {
+        aligned = tlsf_align_up(ptr + gap_min, alignment);
+    }
+
+    if (aligned != ptr) {
+        Tlsf_Block* leading = block;
+        block = tlsf_split(leading, aligned - ptr - TLSF_BLOCK_HEADER);
+        tlsf_insert_free(tlsf, leading);
+    }
+
+    block->size &= ~(u64)TLSF_BLOCK_FREE;
+    tlsf_trim(tlsf, block, size);
+
+    return tlsf_block_to_ptr(block);
+}
+
+static inline
+void*
+tlsf_resize(Tlsf* tlsf, void* ptr, u64 size) {
+    if (!ptr) return tlsf_get(tlsf, size);
+
+    if (size == 0) {
+        tlsf_put(tlsf, ptr);
+        return null;
+    }
+
+    if (size >= TLSF_BLOCK_MAX) return null;
+
+    Tlsf_Block* block   = tlsf_block_from_ptr(ptr);
+    u64         current = tlsf_block_size(block);
+    u64         needed  = tlsf_adjust_size(size);
+
+    if (needed > current) {
+        Tlsf_Block* next = tlsf_block_next(block);
+
+        if (tlsf_block_is_free(next) && current + TLSF_BLOCK_HEADER + tlsf_block_size(next) >= needed) {
+            // grow in place into the free neighbour
+            tlsf_remove_free(tlsf, next);
+            tlsf_merge(block, next);
+        } else {
+            void* new_ptr = tlsf_get(tlsf, size);
+
+            if (!new_ptr) return null;
+
+            memcpy(new_ptr, ptr, current);
+            tlsf_put(tlsf, ptr);
+
+            return new_ptr;
+        }
+    }
+
+    tlsf_trim(tlsf, block, needed);
+
+    return ptr;
+}
+
+static inline
+void
+tlsf_put(Tlsf* tlsf, void* ptr) {
+    if (!ptr) return;
+
+    Tlsf_Block* block = tlsf_block_from_ptr(ptr);
+    Assert(!tlsf_block_is_free(block), "Block has already been freed.");
+
+    Tlsf_Block* prev = block->prev_physical;
+
+    if (prev && tlsf_block_is_free(prev)) {
+        tlsf_remove_free(tlsf, prev);
+        tlsf_merge(prev, block);
+        block = prev;
+    }
+
+    Tlsf_Block* next = tlsf_block_next(block);
+
+    if (tlsf_block_is_free(next)) {
+        tlsf_remove_free(tlsf, next);
+        tlsf_merge(block, next);
+    }
+
+    block->size |= TLSF_BLOCK_FREE;
+    tlsf_insert_free(tlsf, block);
+}
+
+static inline
+Allocator
+tlsf_allocator_make(Tlsf* tlsf) {
+    Allocator allocator = {
+        .alloc         = tlsf_alloc,
+        .alloc_aligned = tlsf_alloc_aligned,
+        .realloc       = tlsf_realloc,
+        .free          = tlsf_free,
+        .context       = tlsf
+    };
+
+    return allocator;
+}
+
+static inline
+void*
+tlsf_alloc(Allocator* allocator, u64 size) {
+    return tlsf_get((Tlsf*)allocator->context, size);
+}
+
+static inline
+void*
+tlsf_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    return tlsf_get((Tlsf*)allocator->context, size, alignment);
+}
+
+static inline
+void*
+tlsf_realloc(Allocator* allocator, void* ptr, u64 size) {
+    return tlsf_resize((Tlsf*)allocator->context, ptr, size);
+}
+
+static inline
+void
+tlsf_free(Allocator* allocator, void* ptr) {
+    tlsf_put((Tlsf*)allocator->context, ptr);
+}
\ No newline at end of file
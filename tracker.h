@@ -0,0 +1,339 @@
+#pragma once
+
+#include "basic.h"
+#include "allocator.h"
+#include "assert.h"
+#include <malloc.h>
+#include <memory.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACKER_MAX_TAGS        64
+#define TRACKER_HISTOGRAM_SIZE  65 // bucket i counts sizes in [2^(i - 1), 2^i)
+#define TRACKER_HEADER_SIZE     16
+
+/*
+    Tracker wraps any allocator and records what goes through it: counts, live and peak bytes,
+    size histogram and the same numbers per call site tag (see ALLOCATOR_TAG in allocator.h).
+    Every allocation gets a 16 bytes header in front of it with its size and tag.
+    Not thread safe, make one per thread or wrap a thread local allocator.
+*/
+struct Tracker_Tag_Stats {
+    const char* tag;
+    u64         allocs;
+    u64         reallocs;
+    u64         frees;
+    u64         live_bytes;
+    u64         peak_bytes;
+    u64         total_bytes; // everything allocated with the tag, including reallocs
+};
+
+struct Tracker_Stats {
+    u64               allocs;
+    u64               reallocs;
+    u64               frees;
+    u64               live_bytes;
+    u64               peak_bytes;
+    u64               total_bytes;
+    u64               histogram[TRACKER_HISTOGRAM_SIZE];
+    u32               tag_count;
+    Tracker_Tag_Stats tags[TRACKER_MAX_TAGS]; // tags[0] is for untagged allocations
+};
+
+struct Tracker {
+    Allocator*    backing;
+    Tracker_Stats stats;
+};
+
+struct Tracker_Header {
+    u64 size;
+    u32 offset; // from the start of the backing allocation to the user pointer
+    u32 tag;
+};
+
+static inline
+Tracker*
+tracker_make(Allocator* backing = &Allocator_Std);
+
+static inline
+void
+tracker_destroy(Tracker* tracker);
+
+static inline
+Allocator
+tracker_allocator_make(Tracker* tracker);
+
+static inline
+void
+tracker_reset(Tracker* tracker); // Clears counters, live bytes of the allocations that are still alive are kept.
+
+static inline
+Tracker_Stats
+tracker_snapshot(Tracker* tracker);
+
+static inline
+void
+tracker_dump(Tracker* tracker, FILE* file = stdout);
+
+static inline
+void*
+tracker_alloc(Allocator* allocator, u64 size);
+
+static inline
+void*
+tracker_alloc_aligned(Allocator* allocator, u64 size, u64 alignment);
+
+static inline
+void*
+tracker_realloc(Allocator* allocator, void* ptr, u64 size);
+
+static inline
+void
+tracker_free(Allocator* allocator, void* ptr);
+
+// Implementation
+static inline
+Tracker*
+tracker_make(Allocator* backing) {
+    Tracker* tracker = (Tracker*)malloc(sizeof(Tracker));
+    Assert(tracker, "Cannot allocate tracker.");
+
+    memset(&tracker->stats, 0, sizeof(Tracker_Stats));
+
+    tracker->backing           = backing;
+    tracker->stats.tag_count   = 1;
+    tracker->stats.tags[0].tag = "untagged";
+
+    return tracker;
+}
+
+static inline
+void
+tracker_destroy(Tracker* tracker) {
+    free(tracker);
+}
+
+static inline
+Allocator
+tracker_allocator_make(Tracker* tracker) {
+    Allocator allocator = {
+        .alloc         = tracker_alloc,
+        .alloc_aligned = tracker_alloc_aligned,
+        .realloc       = tracker_realloc,
+        .free          = tracker_free,
+        .context       = tracker
+    };
+
+    return allocator;
+}
+
+static inline
+void
+tracker_reset(Tracker* tracker) {
+    Tracker_Stats* stats = &tracker->stats;
+
+    stats->allocs      = 0;
+    stats->reallocs    = 0;
+    stats->frees       = 0;
+    stats->peak_bytes  = stats->live_bytes;
+    stats->total_bytes = 0;
+    memset(stats->histogram, 0, sizeof(stats->histogram));
+
+    // tags stay, live allocations point to them
+    for (u32 i = 0; i < stats->tag_count; i++) {
+        Tracker_Tag_Stats* tag = &stats->tags[i];
+
+        tag->allocs      = 0;
+        tag->reallocs    = 0;
+        tag->frees       = 0;
+        tag->peak_bytes  = tag->live_bytes;
+        tag->total_bytes = 0;
+    }
+}
+
+static inline
+Tracker_Stats
+tracker_snapshot(Tracker* tracker) {
+    return tracker->stats;
+}
+
+static inline
+void
+tracker_dump(Tracker* tracker, FILE* file) {
+    Tracker_Stats* stats = &tracker->stats;
+
+    fprintf(file, "allocs: %llu, reallocs: %llu, frees: %llu\n",
+            (unsigned long long)stats->allocs, (unsigned long long)stats->reallocs, (unsigned long long)stats->frees);
+    fprintf(file, "live: %llu bytes, peak: %llu bytes, total: %llu bytes\n",
+            (unsigned long long)stats->live_bytes, (unsigned long long)stats->peak_bytes, (unsigned long long)stats->total_bytes);
+
+    fprintf(file, "%-24s %10s %10s %10s %14s %14s %14s\n", "tag", "allocs", "reallocs", "frees", "live", "peak", "total");
+
+    for (u32 i = 0; i < stats->tag_count; i++) {
+        Tracker_Tag_Stats* tag = &stats->tags[i];
+
+        if (tag->allocs == 0 && tag->reallocs == 0 && tag->frees == 0) continue;
+
+        fprintf(file, "%-24s %10llu %10llu %10llu %14llu %14llu %14llu\n", tag->tag,
+                (unsigned long long)tag->allocs, (unsigned long long)tag->reallocs, (unsigned long long)tag->frees,
+                (unsigned long long)tag->live_bytes, (unsigned long long)tag->peak_bytes, (unsigned long long)tag->total_bytes);
+    }
+
+    fprintf(file, "sizes:\n");
+
+    for (u32 i = 0; i < TRACKER_HISTOGRAM_SIZE; i++) {
+        if (stats->histogram[i] == 0) continue;
+
+        u64 low = i == 0 ? 0 : 1ull << (i - 1);
+        fprintf(file, "  >= %-20llu %llu\n", (unsigned long long)low, (unsigned long long)stats->histogram[i]);
+    }
+}
+
+static inline
+u32
+tracker_tag_index(Tracker* tracker, const char* tag) {
+    if (!tag) return 0;
+
+    Tracker_Stats* stats = &tracker->stats;
+
+    for (u32 i = 1; i < stats->tag_count; i++) {
+        // the same literal may have different addresses in different translation units
+        if (stats->tags[i].tag == tag || strcmp(stats->tags[i].tag, tag) == 0) return i;
+    }
+
+    // out of tags, count it as untagged
+    if (stats->tag_count == TRACKER_MAX_TAGS) return 0;
+
+    Tracker_Tag_Stats* entry = &stats->tags[stats->tag_count];
+    memset(entry, 0, sizeof(Tracker_Tag_Stats));
+    entry->tag = tag;
+
+    return stats->tag_count++;
+}
+
+static inline
+void
+tracker_add(Tracker* tracker, u32 tag, u64 size) {
+    Tracker_Stats*     stats = &tracker->stats;
+    Tracker_Tag_Stats* entry = &stats->tags[tag];
+
+    stats->live_bytes  += size;
+    stats->total_bytes += size;
+    entry->live_bytes  += size;
+    entry->total_bytes += size;
+
+    if (stats->live_bytes > stats->peak_bytes) stats->peak_bytes = stats->live_bytes;
+    if (entry->live_bytes > entry->peak_bytes) entry->peak_bytes = entry->live_bytes;
+
+    stats->histogram[size ? 64 - __builtin_clzll(size) : 0]++;
+}
+
+static inline
+void
+tracker_remove(Tracker* tracker, u32 tag, u64 size) {
+    tracker->stats.live_bytes           -= size;
+    tracker->stats.tags[tag].live_bytes -= size;
+}
+
+static inline
+void*
+tracker_alloc(Allocator* allocator, u64 size) {
+    return tracker_alloc_aligned(allocator, size, ALLOCATOR_DEFAULT_ALIGNMENT);
+}
+
+static inline
+void*
+tracker_alloc_aligned(Allocator* allocator, u64 size, u64 alignment) {
+    Tracker* tracker = (Tracker*)allocator->context;
+
+    // the header takes a whole alignment step, so the user pointer keeps the alignment
+    u64 offset = alignment > TRACKER_HEADER_SIZE ? alignment : TRACKER_HEADER_SIZE;
+    u8* raw;
+
+    if (alignment > ALLOCATOR_DEFAULT_ALIGNMENT) {
+        raw = (u8*)allocator_alloc_aligned(tracker->backing, size + offset, alignment);
+    } else {
+        raw = (u8*)allocator_alloc(tracker->backing, size + offset);
+    }
+
+    if (!raw) return null;
+
+    u8*             ptr    = raw + offset;
+    Tracker_Header* header = (Tracker_Header*)(ptr - TRACKER_HEADER_SIZE);
+
+    header->size   = size;
+    header->offset = (u32)offset;
+    header->tag    = tracker_tag_index(tracker, Allocator_Tag);
+
+    tracker->stats.allocs++;
+    tracker->stats.tags[header->tag].allocs++;
+    tracker_add(tracker, header->tag, size);
+
+    return ptr;
+}
+
+static inline
+void*
+tracker_realloc(Allocator* allocator, void* ptr, u64 size) {
+    if (!ptr) return tracker_alloc(allocator, size);
+
+    Tracker*        tracker = (Tracker*)allocator->context;
+    Tracker_Header* header  = (Tracker_Header*)((u8*)ptr - TRACKER_HEADER_SIZE);
+    u64             old     = header->size;
+    u32             offset  = header->offset;
+
+    tracker_remove(tracker, header->tag, old);
+
+    // the allocation moves to the tag of the realloc call site
+    u32 tag = tracker_tag_index(tracker, Allocator_Tag);
+    u8* new_ptr;
+
+    if (offset == TRACKER_HEADER_SIZE) {
+        u8* raw = (u8*)allocator_realloc(tracker->backing, (u8*)ptr - offset, size + offset);
+
+        if (!raw) {
+            tracker_add(tracker, header->tag, old);
+            return null;
+        }
+
+        new_ptr = raw + offset;
+    } else {
+        // over aligned allocation, backing realloc would lose the alignment
+        u8* raw = (u8*)allocator_alloc_aligned(tracker->backing, size + offset, offset);
+
+        if (!raw) {
+            tracker_add(tracker, header->tag, old);
+            return null;
+        }
+
+        new_ptr = raw + offset;
+        memcpy(new_ptr, ptr, old < size ? old : size);
+        allocator_free(tracker->backing, (u8*)ptr - offset);
+    }
+
+    header         = (Tracker_Header*)(new_ptr - TRACKER_HEADER_SIZE);
+    header->size   = size;
+    header->offset = offset;
+    header->tag    = tag;
+
+    tracker->stats.reallocs++;
+    tracker->stats.tags[tag].reallocs++;
+    tracker_add(tracker, tag, size);
+
+    return new_ptr;
+}
+
+static inline
+void
+tracker_free(Allocator* allocator, void* ptr) {
+    if (!ptr) return;
+
+    Tracker*        tracker = (Tracker*)allocator->context;
+    Tracker_Header* header  = (Tracker_Header*)((u8*)ptr - TRACKER_HEADER_SIZE);
+
+    tracker->stats.frees++;
+    tracker->stats.tags[header->tag].frees++;
+    tracker_remove(tracker, header->tag, header->size);
+
+    allocator_free(tracker->backing, (u8*)ptr - header->offset);
+}
\ No newline at end of file